@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) Alex Nekipelov (alex@nekipelov.net)
+ * License: MIT
+ */
+
+#ifndef HTTPPARSER_BENCHMARKS_HISTOGRAM_H
+#define HTTPPARSER_BENCHMARKS_HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Latency histogram in the style of HdrHistogram: values below 128 are
+// counted exactly, every larger power-of-two range is split into 64
+// buckets, so any value is reported within 1.6% over the whole uint64_t
+// range in fixed memory. Recording is a few instructions and histograms
+// of different threads can be merged.
+class Histogram
+{
+public:
+    Histogram()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        memset(counts, 0, sizeof(counts));
+        total = 0;
+        sum = 0;
+        maxValue = 0;
+    }
+
+    void record(uint64_t value)
+    {
+        ++counts[indexOf(value)];
+        ++total;
+        sum += value;
+
+        if( value > maxValue )
+            maxValue = value;
+    }
+
+    void merge(const Histogram &other)
+    {
+        for(size_t i = 0; i < bucketCount; ++i)
+            counts[i] += other.counts[i];
+
+        total += other.total;
+        sum += other.sum;
+
+        if( other.maxValue > maxValue )
+            maxValue = other.maxValue;
+    }
+
+    uint64_t count() const
+    {
+        return total;
+    }
+
+    uint64_t max() const
+    {
+        return maxValue;
+    }
+
+    double mean() const
+    {
+        return total ? static_cast<double>(sum) / total : 0;
+    }
+
+    // Smallest bucket bound that `percentile` percent of the values do not
+    // exceed.
+    uint64_t percentile(double percentile) const
+    {
+        if( total == 0 )
+            return 0;
+
+        uint64_t wanted = static_cast<uint64_t>(percentile / 100 * total + 0.5);
+
+        if( wanted == 0 )
+            wanted = 1;
+
+        uint64_t seen = 0;
+
+        for(size_t i = 0; i < bucketCount; ++i)
+        {
+            seen += counts[i];
+
+            if( seen >= wanted )
+            {
+                uint64_t upper = highestValueAt(i);
+                return upper < maxValue ? upper : maxValue;
+            }
+        }
+
+        return maxValue;
+    }
+
+private:
+    enum {
+        subBucketBits = 6,
+        subBucketCount = 1 << subBucketBits,            // buckets per power of two
+        linearCount = 2 * subBucketCount,               // values counted exactly
+        bucketCount = (64 - subBucketBits) * subBucketCount + subBucketCount
+    };
+
+    static size_t indexOf(uint64_t value)
+    {
+        if( value < linearCount )
+            return static_cast<size_t>(value);
+
+        unsigned shift = 63 - __builtin_clzll(value) - subBucketBits;
+        return shift * subBucketCount + static_cast<size_t>(value >> shift);
+    }
+
+    static uint64_t highestValueAt(size_t index)
+    {
+        if( index < linearCount )
+            return index;
+
+        unsigned shift = static_cast<unsigned>(index / subBucketCount - 1);
+        uint64_t sub = index - shift * subBucketCount;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    uint64_t counts[bucketCount];
+    uint64_t total;
+    uint64_t sum;
+    uint64_t maxValue;
+};
+
+#endif // HTTPPARSER_BENCHMARKS_HISTOGRAM_H
@@ -0,0 +1,1304 @@
+/*
+ * Copyright (C) Alex Nekipelov (alex@nekipelov.net)
+ * License: MIT
+ */
+
+// Loopback HTTP server for end-to-end benchmarks with keep-alive and
+// pipelining. Every request gets the same small response.
+//
+//     httpserver [--port 8080] [--threads 1] [--backend epoll|uring] [--workers 0]
+//
+// With --threads N the server runs N independent reactors, one per thread,
+// each pinned to its own core and accepting on its own SO_REUSEPORT socket,
+// so the kernel spreads connections across them. A reactor owns its
+// listener, event queue, connections, parser pool and counters; nothing
+// is shared between threads while serving.
+//
+// The epoll backend is an edge-triggered loop that reads into a buffer per
+// connection. The uring backend (Linux 6.0 or later) uses multishot accept
+// and multishot receive into provided buffers: the parser reads each
+// request straight from the buffer the kernel filled, which is then handed
+// back, so received bytes are never copied. Both backends share the parse
+// and response code.
+//
+// With --workers N (epoll only) requests are answered by N worker threads
+// instead of the reactor that parsed them. A reactor hands each parsed
+// request, still in its pool entry, to the connection's worker through a
+// bounded single-producer queue; the worker answers and returns it through
+// the reactor's multi-producer completion queue, and the reactor writes
+// the response and recycles the entry. Both sides dequeue in batches and
+// sleep on an eventfd only when their queues stay empty. Every connection
+// sticks to one worker, so pipelined responses keep their order.
+//
+// Stop it with Ctrl-C; it prints the number of requests served by each
+// reactor.
+
+#include <httpparser/request.h>
+#include <httpparser/response.h>
+#include <httpparser/httprequestparser.h>
+#include <httpparser/httpserializer.h>
+#include <httpparser/parserpool.h>
+#include <httpparser/connectionbuffer.h>
+
+#include "ringqueue.h"
+
+#ifdef HTTPPARSER_HAVE_IO_URING
+#include "iouring.h"
+#endif
+
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace httpparser;
+
+typedef ParserPool<HttpRequestParser, Request> RequestPool;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int)
+{
+    stopRequested = 1;
+}
+
+static void fail(const char *what)
+{
+    perror(what);
+    exit(EXIT_FAILURE);
+}
+
+static void setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+
+    if( flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0 )
+        fail("fcntl");
+}
+
+static int listenLoopback(unsigned short port, bool reusePort)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    if( fd < 0 )
+        fail("socket");
+
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    if( reusePort && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0 )
+        fail("SO_REUSEPORT");
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if( bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0 )
+        fail("bind");
+
+    if( listen(fd, SOMAXCONN) < 0 )
+        fail("listen");
+
+    setNonBlocking(fd);
+    return fd;
+}
+
+// The answer to every request and the one to a malformed request.
+static void buildResponses(std::vector<char> &okResponse, std::vector<char> &errorResponse)
+{
+    Response resp;
+    resp.versionMajor = 1;
+    resp.versionMinor = 1;
+    resp.statusCode = 200;
+    resp.status = "OK";
+    resp.headers.resize(1);
+    resp.headers[0].name = "Content-Length";
+    resp.headers[0].value = "13";
+    resp.content.assign("Hello, world!", "Hello, world!" + 13);
+    HttpSerializer::serialize(resp, okResponse);
+
+    const char badRequest[] = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    errorResponse.assign(badRequest, badRequest + sizeof(badRequest) - 1);
+}
+
+// What every backend shares: the listener, the parser pool, the canned
+// responses and the request counter.
+class Shard
+{
+public:
+    Shard(unsigned short port, bool reusePort)
+        : listenFd(listenLoopback(port, reusePort)), pool(poolSize), requests(0)
+    {
+        buildResponses(okResponse, errorResponse);
+    }
+
+    ~Shard()
+    {
+        close(listenFd);
+    }
+
+    unsigned long long served() const
+    {
+        return requests;
+    }
+
+protected:
+    // Answer every complete request in [begin, end), pipelined ones
+    // included, appending the responses to `output`. `begin` is left at
+    // the first byte the parser did not use. Returns false once the
+    // connection has to be closed after the write: after a malformed
+    // request or one that did not ask for keep-alive.
+    bool serve(RequestPool::Entry *&entry, const char *&begin, const char *end, std::vector<char> &output)
+    {
+        while( begin < end )
+        {
+            HttpRequestParser::ParseResult res = entry->parser.parse(entry->message, begin, end);
+            begin += entry->parser.consumed();
+
+            if( res == HttpRequestParser::ParsingCompleted )
+            {
+                bool keepAlive = entry->message.keepAlive;
+
+                ++requests;
+                output.insert(output.end(), okResponse.begin(), okResponse.end());
+
+                // Swap in a fresh pair; the pool keeps the warmed buffers.
+                pool.release(entry);
+                entry = pool.acquire();
+
+                if( !keepAlive )
+                    return false;
+            }
+            else if( res == HttpRequestParser::ParsingError )
+            {
+                output.insert(output.end(), errorResponse.begin(), errorResponse.end());
+                begin = end;
+                return false;
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    enum {
+        bufferSize = 16 * 1024,
+        poolSize = 1024
+    };
+
+    int listenFd;
+    RequestPool pool;
+    std::vector<char> okResponse;
+    std::vector<char> errorResponse;
+    unsigned long long requests;
+};
+
+struct Connection
+{
+    explicit Connection(const ConnectionBuffer::Limits &inputLimits)
+        : fd(-1), input(inputLimits), closeAfterWrite(false), entry(NULL), worker(0), inFlight(0),
+          writePending(false)
+    {}
+
+    int fd;                    // -1 once closed while requests are in flight
+    ConnectionBuffer input;    // received bytes the parser has not used
+    std::vector<char> output;  // responses not written yet
+    bool closeAfterWrite;
+    RequestPool::Entry *entry; // parser and request from the reactor's pool
+
+    // With --workers only.
+    size_t worker;             // the worker every request goes to
+    size_t inFlight;           // requests handed off and not answered yet
+    bool writePending;         // answered since the last write
+};
+
+// A request on its way to a worker and back.
+struct Job
+{
+    Connection *conn;
+    RequestPool::Entry *entry;          // NULL for a malformed request
+    const std::vector<char> *response;  // set by the worker
+};
+
+// Wakes a thread blocked on an eventfd, but only if it said it is going to
+// sleep, so a busy consumer costs its producers no system calls. The
+// sleeper calls prepare(), checks its queues once more and only then
+// blocks on descriptor(); a producer pushes first and calls wake() after.
+class Waiter
+{
+public:
+    Waiter() : fd(eventfd(0, EFD_NONBLOCK)), sleeping(false)
+    {
+        if( fd < 0 )
+            fail("eventfd");
+    }
+
+    ~Waiter()
+    {
+        close(fd);
+    }
+
+    int descriptor() const
+    {
+        return fd;
+    }
+
+    void prepare()
+    {
+        sleeping.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    // Back to work, after sleeping or after finding work instead.
+    void awake()
+    {
+        // A producer that cleared the flag has written to the eventfd.
+        if( !sleeping.exchange(false) )
+        {
+            uint64_t value;
+            ssize_t n = read(fd, &value, sizeof(value));
+            (void)n;
+        }
+    }
+
+    void wake()
+    {
+        if( sleeping.load(std::memory_order_relaxed) && sleeping.exchange(false) )
+        {
+            uint64_t one = 1;
+            ssize_t n = write(fd, &one, sizeof(one));
+            (void)n;
+        }
+    }
+
+private:
+    Waiter(const Waiter &);
+    Waiter &operator=(const Waiter &);
+
+    int fd;
+    std::atomic<bool> sleeping;
+};
+
+// The queues between R reactors and W workers: one single-producer queue
+// per reactor and worker pair for requests, one multi-producer queue per
+// reactor for answered requests.
+class Pipeline
+{
+public:
+    Pipeline(size_t reactorCount, size_t workerCount)
+        : stalls(reactorCount, 0), reactorCount(reactorCount), workerCount(workerCount),
+          reactorWaiters(reactorCount), workerWaiters(workerCount)
+    {
+        buildResponses(okResponse, errorResponse);
+
+        for(size_t i = 0; i < reactorCount * workerCount; ++i)
+            requestQueues.push_back(new SpscQueue<Job>(queueSize));
+
+        for(size_t i = 0; i < reactorCount; ++i)
+            completionQueues.push_back(new MpmcQueue<Job>(queueSize * workerCount));
+    }
+
+    ~Pipeline()
+    {
+        for(size_t i = 0; i < requestQueues.size(); ++i)
+            delete requestQueues[i];
+
+        for(size_t i = 0; i < completionQueues.size(); ++i)
+            delete completionQueues[i];
+    }
+
+    size_t reactors() const
+    {
+        return reactorCount;
+    }
+
+    size_t workers() const
+    {
+        return workerCount;
+    }
+
+    SpscQueue<Job> &requests(size_t reactor, size_t worker)
+    {
+        return *requestQueues[reactor * workerCount + worker];
+    }
+
+    MpmcQueue<Job> &completions(size_t reactor)
+    {
+        return *completionQueues[reactor];
+    }
+
+    Waiter &reactorWaiter(size_t reactor)
+    {
+        return reactorWaiters[reactor];
+    }
+
+    Waiter &workerWaiter(size_t worker)
+    {
+        return workerWaiters[worker];
+    }
+
+    enum {
+        queueSize = 1024,
+        batchSize = 64
+    };
+
+    std::vector<char> okResponse;
+    std::vector<char> errorResponse;
+    std::vector<unsigned long long> stalls;  // per reactor: pushes that found a worker's queue full
+
+private:
+    Pipeline(const Pipeline &);
+    Pipeline &operator=(const Pipeline &);
+
+    size_t reactorCount;
+    size_t workerCount;
+    std::vector<SpscQueue<Job> *> requestQueues;
+    std::vector<MpmcQueue<Job> *> completionQueues;
+    std::vector<Waiter> reactorWaiters;
+    std::vector<Waiter> workerWaiters;
+};
+
+class EpollReactor : public Shard
+{
+public:
+    // With a pipeline the reactor only parses; `index` is its place in it.
+    EpollReactor(unsigned short port, bool reusePort, Pipeline *pipeline = NULL, size_t index = 0)
+        : Shard(port, reusePort), epollFd(epoll_create1(0)), pipeline(pipeline), index(index), nextWorker(0)
+    {
+        if( epollFd < 0 )
+            fail("epoll_create1");
+
+        inputLimits.initialCapacity = bufferSize;
+        inputLimits.minRead = bufferSize / 4;
+
+        watch(listenFd, EPOLLIN, NULL);
+
+        if( pipeline )
+            watch(pipeline->reactorWaiter(index).descriptor(), EPOLLIN, &pipeline->reactorWaiter(index));
+    }
+
+    ~EpollReactor()
+    {
+        for(std::map<int, Connection *>::iterator it = connections.begin(); it != connections.end(); ++it)
+        {
+            close(it->first);
+            pool.release(it->second->entry);
+            delete it->second;
+        }
+
+        close(epollFd);
+    }
+
+    void run()
+    {
+        struct epoll_event events[256];
+
+        while( !stopRequested )
+        {
+            int timeout = 100;
+
+            if( pipeline && !prepareToWait() )
+                timeout = 0;
+
+            int count = epoll_wait(epollFd, events, 256, timeout);
+
+            if( count < 0 && errno != EINTR )
+                fail("epoll_wait");
+
+            if( pipeline )
+                pipeline->reactorWaiter(index).awake();
+
+            for(int i = 0; i < count; ++i)
+            {
+                void *tag = events[i].data.ptr;
+
+                if( tag == NULL )
+                {
+                    acceptAll();
+                    continue;
+                }
+
+                if( pipeline && tag == &pipeline->reactorWaiter(index) )
+                    continue;
+
+                Connection &conn = *static_cast<Connection *>(tag);
+                bool open = true;
+
+                if( events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP) )
+                    open = readAll(conn);
+
+                if( open )
+                    open = writeAll(conn);
+
+                if( !open )
+                    closeConnection(conn);
+            }
+
+            // After the events: a connection this closes may have had one
+            // in the same batch.
+            if( pipeline )
+                completeAll();
+        }
+    }
+
+private:
+    // Events for `fd` carry `tag`: the Connection, the pipeline's Waiter,
+    // or NULL for the listening socket.
+    void watch(int fd, unsigned int events, void *tag)
+    {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = events;
+        ev.data.ptr = tag;
+
+        if( epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) < 0 )
+            fail("epoll_ctl");
+    }
+
+    void acceptAll()
+    {
+        for(;;)
+        {
+            int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK);
+
+            if( fd < 0 )
+            {
+                if( errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR )
+                    perror("accept4");
+                return;
+            }
+
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+            Connection *conn = new Connection(inputLimits);
+            conn->fd = fd;
+            conn->entry = pool.acquire();
+            connections[fd] = conn;
+
+            if( pipeline )
+                conn->worker = nextWorker++ % pipeline->workers();
+
+            // Edge-triggered: one registration for the whole lifetime.
+            watch(fd, EPOLLIN | EPOLLOUT | EPOLLET | EPOLLRDHUP, conn);
+        }
+    }
+
+    // Read until the socket is drained, parsing as data arrives. Returns
+    // false if the connection should be closed.
+    bool readAll(Connection &conn)
+    {
+        for(;;)
+        {
+            // The parser uses every byte it is given, so there is always
+            // room: the buffer never holds more than a read.
+            size_t room = conn.input.prepare();
+            ssize_t n = read(conn.fd, conn.input.writeBegin(), room);
+
+            if( n <= 0 )
+            {
+                if( n == 0 )
+                {
+                    // The client is done sending but may still read:
+                    // answer what it sent, including requests still at a
+                    // worker, before closing.
+                    conn.closeAfterWrite = true;
+                    conn.input.clear();
+                    return true;
+                }
+                else if( errno == EAGAIN || errno == EWOULDBLOCK )
+                    return true;
+                else if( errno != EINTR )
+                    return false;
+
+                continue;
+            }
+
+            conn.input.commit(n);
+
+            if( !parseAll(conn) )
+                return true;  // the last response closes it, wait for the write
+        }
+    }
+
+    // Parse every complete request in the input buffer. Returns false once
+    // nothing more will be read from the connection.
+    bool parseAll(Connection &conn)
+    {
+        if( conn.closeAfterWrite )
+        {
+            conn.input.clear();
+            return false;
+        }
+
+        const char *begin = conn.input.begin();
+        const char *end = conn.input.end();
+
+        if( pipeline )
+            conn.closeAfterWrite = !dispatch(conn, begin, end);
+        else
+            conn.closeAfterWrite = !serve(conn.entry, begin, end, conn.output);
+
+        conn.input.consume(begin - conn.input.begin());
+
+        return !conn.closeAfterWrite;
+    }
+
+    // Like serve(), but hands every parsed request to the connection's
+    // worker instead of answering it. A malformed request goes the same way
+    // with no entry, so that its error response stays behind the answers
+    // to the requests before it.
+    bool dispatch(Connection &conn, const char *&begin, const char *end)
+    {
+        while( begin < end )
+        {
+            HttpRequestParser::ParseResult res = conn.entry->parser.parse(conn.entry->message, begin, end);
+            begin += conn.entry->parser.consumed();
+
+            if( res == HttpRequestParser::ParsingCompleted )
+            {
+                bool keepAlive = conn.entry->message.keepAlive;
+
+                handOff(conn, conn.entry);
+                conn.entry = pool.acquire();
+
+                if( !keepAlive )
+                    return false;
+            }
+            else if( res == HttpRequestParser::ParsingError )
+            {
+                handOff(conn, NULL);
+                begin = end;
+                return false;
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    void handOff(Connection &conn, RequestPool::Entry *entry)
+    {
+        Job job = { &conn, entry, NULL };
+        SpscQueue<Job> &queue = pipeline->requests(index, conn.worker);
+
+        ++conn.inFlight;
+
+        // The worker may itself be waiting for room in our completion
+        // queue, so drain that while waiting for room in its queue.
+        while( !queue.push(job) )
+        {
+            ++pipeline->stalls[index];
+            pipeline->workerWaiter(conn.worker).wake();
+            drainCompletions();
+            std::this_thread::yield();
+        }
+
+        pipeline->workerWaiter(conn.worker).wake();
+    }
+
+    // Announce that the reactor is about to block in epoll_wait. Returns
+    // false if answers are already waiting and it should not block.
+    bool prepareToWait()
+    {
+        pipeline->reactorWaiter(index).prepare();
+
+        Job job;
+
+        if( !pipeline->completions(index).pop(job) )
+            return true;
+
+        complete(job);
+        return false;
+    }
+
+    // Take every answered request, then write the responses, one write
+    // per connection for the whole batch.
+    void completeAll()
+    {
+        drainCompletions();
+
+        for(size_t i = 0; i < answered.size(); ++i)
+        {
+            Connection &conn = *answered[i];
+            conn.writePending = false;
+
+            if( conn.fd < 0 )
+            {
+                if( conn.inFlight == 0 )
+                    delete &conn;
+            }
+            else if( !writeAll(conn) )
+            {
+                closeConnection(conn);
+            }
+        }
+
+        answered.clear();
+    }
+
+    // Append the answers to the connections' output without writing, so
+    // that no connection is closed while one is being parsed.
+    void drainCompletions()
+    {
+        Job jobs[Pipeline::batchSize];
+        size_t count;
+
+        while( (count = pipeline->completions(index).popBatch(jobs, Pipeline::batchSize)) > 0 )
+        {
+            for(size_t i = 0; i < count; ++i)
+                complete(jobs[i]);
+        }
+    }
+
+    void complete(const Job &job)
+    {
+        Connection &conn = *job.conn;
+        --conn.inFlight;
+
+        if( job.entry )
+        {
+            ++requests;
+            pool.release(job.entry);
+        }
+
+        if( conn.fd < 0 )
+        {
+            // Closed while this request was with a worker.
+            if( conn.inFlight == 0 && !conn.writePending )
+                delete &conn;
+            return;
+        }
+
+        conn.output.insert(conn.output.end(), job.response->begin(), job.response->end());
+
+        if( !conn.writePending )
+        {
+            conn.writePending = true;
+            answered.push_back(&conn);
+        }
+    }
+
+    // Write as much pending output as the socket takes. Returns false if
+    // the connection should be closed.
+    bool writeAll(Connection &conn)
+    {
+        size_t written = 0;
+
+        while( written < conn.output.size() )
+        {
+            ssize_t n = write(conn.fd, &conn.output[written], conn.output.size() - written);
+
+            if( n < 0 )
+            {
+                if( errno == EAGAIN || errno == EWOULDBLOCK )
+                    break;
+                else if( errno != EINTR )
+                    return false;
+
+                continue;
+            }
+
+            written += n;
+        }
+
+        conn.output.erase(conn.output.begin(), conn.output.begin() + written);
+
+        return !(conn.closeAfterWrite && conn.output.empty() && conn.inFlight == 0);
+    }
+
+    // A connection with requests at a worker stays allocated, marked
+    // closed, until the last of them comes back.
+    void closeConnection(Connection &conn)
+    {
+        connections.erase(conn.fd);
+        close(conn.fd);
+        pool.release(conn.entry);
+        conn.entry = NULL;
+        conn.fd = -1;
+
+        // Otherwise the last answer or the pending write frees it.
+        if( conn.inFlight == 0 && !conn.writePending )
+            delete &conn;
+    }
+
+    int epollFd;
+    std::map<int, Connection *> connections;  // open ones, to free at the end
+    ConnectionBuffer::Limits inputLimits;
+
+    Pipeline *pipeline;
+    size_t index;
+    size_t nextWorker;
+    std::vector<Connection *> answered;  // connections with new responses
+};
+
+#ifdef HTTPPARSER_HAVE_IO_URING
+
+struct RingConnection
+{
+    RingConnection()
+        : fd(-1), sent(0), receiving(false), sending(false), closeAfterWrite(false), closing(false),
+          entry(NULL)
+    {}
+
+    int fd;
+    std::vector<char> carry;    // received bytes the parser left unused
+    std::vector<char> inFlight; // output of the send in progress
+    std::vector<char> output;   // responses queued behind it
+    size_t sent;                // bytes of inFlight already sent
+    bool receiving;             // the multishot receive is armed
+    bool sending;               // a send is in progress
+    bool closeAfterWrite;
+    bool closing;               // shut down, waiting for the operations to end
+    RequestPool::Entry *entry;
+};
+
+class UringReactor : public Shard
+{
+public:
+    UringReactor(unsigned short port, bool reusePort)
+        : Shard(port, reusePort), ring(queueDepth), buffers(ring, bufferGroup, bufferCount, bufferSize)
+    {
+        if( !ring.valid() )
+            fail("io_uring_setup");
+
+        if( !buffers.valid() )
+            fail("malloc");
+
+        armAccept();
+    }
+
+    ~UringReactor()
+    {
+        for(std::map<int, RingConnection *>::iterator it = connections.begin(); it != connections.end(); ++it)
+        {
+            close(it->first);
+            pool.release(it->second->entry);
+            delete it->second;
+        }
+    }
+
+    void run()
+    {
+        while( !stopRequested )
+        {
+            ring.submitAndWait(100);
+
+            while( struct io_uring_cqe *cqe = ring.peek() )
+            {
+                uint64_t data = cqe->user_data;
+                int res = cqe->res;
+                unsigned int flags = cqe->flags;
+
+                ring.advance();
+                complete(static_cast<Operation>(data & operationMask),
+                         reinterpret_cast<RingConnection *>(static_cast<uintptr_t>(data & ~uint64_t(operationMask))),
+                         res, flags);
+            }
+        }
+    }
+
+private:
+    enum Operation {
+        Provide = 0,  // see ProvidedBuffers
+        Accept,
+        Receive,
+        Send
+    };
+
+    // user_data packs the connection with the operation in its low bits,
+    // which are always 0 in the pointer, so a completion finds its
+    // connection without a lookup. Provide and Accept have none.
+    enum {
+        operationMask = 3
+    };
+
+    static uint64_t userData(Operation op, RingConnection *conn)
+    {
+        return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(conn)) | op;
+    }
+
+    void armAccept()
+    {
+        struct io_uring_sqe *sqe = ring.sqe();
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = listenFd;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->user_data = userData(Accept, NULL);
+    }
+
+    void armReceive(RingConnection &conn)
+    {
+        struct io_uring_sqe *sqe = ring.sqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = conn.fd;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = buffers.id();
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->user_data = userData(Receive, &conn);
+        conn.receiving = true;
+    }
+
+    // Start sending queued output unless a send is already in progress.
+    void flush(RingConnection &conn)
+    {
+        if( conn.sending || conn.closing )
+            return;
+
+        if( conn.sent == conn.inFlight.size() )
+        {
+            conn.inFlight.clear();
+            conn.inFlight.swap(conn.output);
+            conn.sent = 0;
+        }
+
+        if( conn.inFlight.empty() )
+        {
+            if( conn.closeAfterWrite )
+                shutdownConnection(conn);
+            return;
+        }
+
+        struct io_uring_sqe *sqe = ring.sqe();
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = conn.fd;
+        sqe->addr = reinterpret_cast<uintptr_t>(&conn.inFlight[conn.sent]);
+        sqe->len = static_cast<uint32_t>(conn.inFlight.size() - conn.sent);
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = userData(Send, &conn);
+        conn.sending = true;
+    }
+
+    void complete(Operation op, RingConnection *connection, int res, unsigned int flags)
+    {
+        if( op == Provide )
+        {
+            if( res < 0 )
+            {
+                std::cerr << "IORING_OP_PROVIDE_BUFFERS: " << strerror(-res) << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            return;
+        }
+        else if( op == Accept )
+        {
+            if( res >= 0 )
+                accepted(res);
+            else if( res != -EINTR && res != -EAGAIN )
+                std::cerr << "accept: " << strerror(-res) << std::endl;
+
+            if( !(flags & IORING_CQE_F_MORE) )
+                armAccept();
+            return;
+        }
+
+        // Freed only once no operation refers to it, so this is alive.
+        RingConnection &conn = *connection;
+
+        if( op == Receive )
+            received(conn, res, flags);
+        else
+            sent(conn, res);
+
+        if( conn.closing && !conn.receiving && !conn.sending )
+        {
+            connections.erase(conn.fd);
+            close(conn.fd);
+            pool.release(conn.entry);
+            delete connection;
+        }
+    }
+
+    void accepted(int fd)
+    {
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        RingConnection *conn = new RingConnection;
+        conn->fd = fd;
+        conn->entry = pool.acquire();
+        connections[fd] = conn;
+
+        armReceive(*conn);
+    }
+
+    void received(RingConnection &conn, int res, unsigned int flags)
+    {
+        if( !(flags & IORING_CQE_F_MORE) )
+            conn.receiving = false;
+
+        if( flags & IORING_CQE_F_BUFFER )
+        {
+            uint16_t bid = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+
+            if( res > 0 && !conn.closeAfterWrite && !conn.closing )
+                parse(conn, buffers.buffer(bid), res);
+
+            buffers.recycle(bid);
+        }
+
+        if( res == 0 )
+        {
+            // The client is done sending: answer what it sent, then close.
+            conn.closeAfterWrite = true;
+            conn.carry.clear();
+        }
+        else if( res < 0 && res != -ENOBUFS )
+        {
+            shutdownConnection(conn);
+            return;
+        }
+
+        if( !conn.receiving && !conn.closing && !conn.closeAfterWrite )
+            armReceive(conn);
+
+        flush(conn);
+    }
+
+    // Parse straight from the kernel's buffer. The parser keeps its state
+    // between calls and normally uses every byte, so nothing is copied;
+    // only bytes it leaves unused are kept for the next receive.
+    void parse(RingConnection &conn, const char *data, size_t size)
+    {
+        if( !conn.carry.empty() )
+        {
+            conn.carry.insert(conn.carry.end(), data, data + size);
+            data = &conn.carry[0];
+            size = conn.carry.size();
+        }
+
+        const char *begin = data;
+        const char *end = data + size;
+
+        conn.closeAfterWrite = !serve(conn.entry, begin, end, conn.output);
+
+        if( conn.carry.empty() )
+            conn.carry.assign(begin, end);
+        else
+            conn.carry.erase(conn.carry.begin(), conn.carry.begin() + (begin - data));
+    }
+
+    void sent(RingConnection &conn, int res)
+    {
+        conn.sending = false;
+
+        if( res < 0 )
+        {
+            shutdownConnection(conn);
+            return;
+        }
+
+        conn.sent += res;
+        flush(conn);
+    }
+
+    // Shutting the socket down ends the multishot receive; the connection
+    // is freed once no operation refers to it.
+    void shutdownConnection(RingConnection &conn)
+    {
+        if( !conn.closing )
+        {
+            conn.closing = true;
+            shutdown(conn.fd, SHUT_RDWR);
+        }
+    }
+
+    enum {
+        queueDepth = 4096,
+        bufferGroup = 0,
+        bufferCount = 512
+    };
+
+    IoUring ring;
+    ProvidedBuffers buffers;
+    std::map<int, RingConnection *> connections;  // open ones, to free at the end
+};
+
+#endif // HTTPPARSER_HAVE_IO_URING
+
+// Pin the calling thread to one core.
+static void pinToCore(size_t core)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+
+    if( pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0 )
+        std::cerr << "cannot pin thread to core " << core << std::endl;
+}
+
+// Build a reactor in the thread that runs it, so its memory is allocated
+// close to its core.
+template <typename Reactor>
+static void runShard(unsigned short port, size_t index, size_t count, unsigned long long *served)
+{
+    if( count > 1 )
+        pinToCore(index % std::thread::hardware_concurrency());
+
+    Reactor reactor(port, count > 1);
+    reactor.run();
+    *served = reactor.served();
+}
+
+// Reactor with --workers: the pipeline outlives every thread using it.
+static void runPipelinedShard(unsigned short port, size_t index, size_t count, Pipeline *pipeline,
+                              unsigned long long *served)
+{
+    if( count > 1 )
+        pinToCore(index % std::thread::hardware_concurrency());
+
+    EpollReactor reactor(port, count > 1, pipeline, index);
+    reactor.run();
+    *served = reactor.served();
+}
+
+// Answers requests for every reactor. The answer here is the canned
+// response; a real handler would read the request from the entry.
+class Worker
+{
+public:
+    Worker(Pipeline &pipeline, size_t index)
+        : pipeline(pipeline), index(index), handled(0), batches(0)
+    {
+    }
+
+    void run()
+    {
+        pinToCore((pipeline.reactors() + index) % std::thread::hardware_concurrency());
+
+        Job jobs[Pipeline::batchSize];
+
+        while( !stopRequested )
+        {
+            bool idle = true;
+
+            for(size_t r = 0; r < pipeline.reactors(); ++r)
+            {
+                size_t count = pipeline.requests(r, index).popBatch(jobs, Pipeline::batchSize);
+
+                if( count == 0 )
+                    continue;
+
+                for(size_t i = 0; i < count; ++i)
+                    jobs[i].response = jobs[i].entry ? &pipeline.okResponse : &pipeline.errorResponse;
+
+                for(size_t i = 0; i < count; ++i)
+                {
+                    while( !pipeline.completions(r).push(jobs[i]) )
+                    {
+                        pipeline.reactorWaiter(r).wake();
+                        std::this_thread::yield();
+                    }
+                }
+
+                pipeline.reactorWaiter(r).wake();
+
+                handled += count;
+                ++batches;
+                idle = false;
+            }
+
+            if( idle )
+                wait();
+        }
+    }
+
+    unsigned long long requests() const
+    {
+        return handled;
+    }
+
+    double averageBatch() const
+    {
+        return batches ? static_cast<double>(handled) / batches : 0;
+    }
+
+private:
+    enum {
+        spins = 256,
+        sleepMs = 100
+    };
+
+    bool hasWork()
+    {
+        for(size_t r = 0; r < pipeline.reactors(); ++r)
+        {
+            if( !pipeline.requests(r, index).empty() )
+                return true;
+        }
+
+        return false;
+    }
+
+    // Spin a little before sleeping: under load the next batch is usually
+    // a few microseconds away.
+    void wait()
+    {
+        for(int i = 0; i < spins; ++i)
+        {
+            if( hasWork() )
+                return;
+
+            std::this_thread::yield();
+        }
+
+        Waiter &waiter = pipeline.workerWaiter(index);
+        waiter.prepare();
+
+        if( !hasWork() )
+        {
+            struct pollfd pfd;
+            pfd.fd = waiter.descriptor();
+            pfd.events = POLLIN;
+            poll(&pfd, 1, sleepMs);
+        }
+
+        waiter.awake();
+    }
+
+    Pipeline &pipeline;
+    size_t index;
+    unsigned long long handled;
+    unsigned long long batches;
+};
+
+static void runWorker(Worker *worker)
+{
+    worker->run();
+}
+
+int main(int argc, char **argv)
+{
+    unsigned short port = 8080;
+    size_t threads = 1;
+    const char *backend = "epoll";
+    size_t workers = 0;
+    void (*shard)(unsigned short, size_t, size_t, unsigned long long *) = runShard<EpollReactor>;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if( strcmp(argv[i], "--port") == 0 && i + 1 < argc )
+        {
+            port = static_cast<unsigned short>(atoi(argv[++i]));
+        }
+        else if( strcmp(argv[i], "--threads") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0 )
+        {
+            threads = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if( strcmp(argv[i], "--workers") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 0 )
+        {
+            workers = static_cast<size_t>(atoi(argv[++i]));
+        }
+        else if( strcmp(argv[i], "--backend") == 0 && i + 1 < argc && strcmp(argv[i + 1], "epoll") == 0 )
+        {
+            backend = argv[++i];
+            shard = runShard<EpollReactor>;
+        }
+#ifdef HTTPPARSER_HAVE_IO_URING
+        else if( strcmp(argv[i], "--backend") == 0 && i + 1 < argc && strcmp(argv[i + 1], "uring") == 0 )
+        {
+            backend = argv[++i];
+            shard = runShard<UringReactor>;
+        }
+#endif
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--port N] [--threads N] [--backend epoll"
+#ifdef HTTPPARSER_HAVE_IO_URING
+                      << "|uring"
+#endif
+                      << "] [--workers N]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if( workers > 0 && strcmp(backend, "epoll") != 0 )
+    {
+        std::cerr << "--workers needs the epoll backend" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    std::vector<unsigned long long> served(threads, 0);
+    std::vector<std::thread> shards;
+    Pipeline *pipeline = workers > 0 ? new Pipeline(threads, workers) : NULL;
+    std::vector<Worker *> handlers;
+    std::vector<std::thread> workerThreads;
+
+    for(size_t i = 0; i < workers; ++i)
+    {
+        handlers.push_back(new Worker(*pipeline, i));
+        workerThreads.push_back(std::thread(runWorker, handlers[i]));
+    }
+
+    for(size_t i = 0; i < threads; ++i)
+    {
+        if( workers > 0 )
+            shards.push_back(std::thread(runPipelinedShard, port, i, threads, pipeline, &served[i]));
+        else
+            shards.push_back(std::thread(shard, port, i, threads, &served[i]));
+    }
+
+    std::cout << "listening on 127.0.0.1:" << port << " with " << threads << " " << backend << " reactor(s)";
+
+    if( workers > 0 )
+        std::cout << " and " << workers << " worker(s)";
+
+    std::cout << std::endl;
+
+    unsigned long long total = 0;
+
+    for(size_t i = 0; i < threads; ++i)
+    {
+        shards[i].join();
+        total += served[i];
+
+        if( threads > 1 )
+            std::cout << "reactor " << i << ": " << served[i] << " requests" << std::endl;
+
+        if( workers > 0 )
+            std::cout << "reactor " << i << ": worker queue full " << pipeline->stalls[i] << " time(s)" << std::endl;
+    }
+
+    for(size_t i = 0; i < workers; ++i)
+    {
+        workerThreads[i].join();
+        std::cout << "worker " << i << ": " << handlers[i]->requests() << " requests, "
+                  << handlers[i]->averageBatch() << " per batch" << std::endl;
+        delete handlers[i];
+    }
+
+    delete pipeline;
+
+    std::cout << "requests served: " << total << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) Alex Nekipelov (alex@nekipelov.net)
+ * License: MIT
+ */
+
+#ifndef HTTPPARSER_BENCHMARKS_IOURING_H
+#define HTTPPARSER_BENCHMARKS_IOURING_H
+
+// Minimal io_uring access through the raw system calls, so the benchmarks
+// need only the kernel headers and not liburing. Covers what the server
+// uses: one submission and completion queue pair and a group of provided
+// buffers.
+
+#include <linux/io_uring.h>
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+class IoUring
+{
+public:
+    // Check valid() afterwards; io_uring may be missing or disabled.
+    explicit IoUring(unsigned entries)
+        : ringFd(-1), sqRing(MAP_FAILED), cqRing(MAP_FAILED), sqes(NULL), queued(0)
+    {
+        memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = entries * 4;
+
+        ringFd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+
+        if( ringFd < 0 )
+            return;
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+        if( params.features & IORING_FEAT_SINGLE_MMAP )
+        {
+            if( cqRingSize > sqRingSize )
+                sqRingSize = cqRingSize;
+
+            cqRingSize = sqRingSize;
+        }
+
+        sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ringFd, IORING_OFF_SQ_RING);
+
+        if( sqRing == MAP_FAILED )
+        {
+            destroy();
+            return;
+        }
+
+        if( params.features & IORING_FEAT_SINGLE_MMAP )
+        {
+            cqRing = sqRing;
+        }
+        else
+        {
+            cqRing = mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ringFd, IORING_OFF_CQ_RING);
+
+            if( cqRing == MAP_FAILED )
+            {
+                destroy();
+                return;
+            }
+        }
+
+        void *sqesMemory = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe),
+                                PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+
+        if( sqesMemory == MAP_FAILED )
+        {
+            destroy();
+            return;
+        }
+
+        sqes = static_cast<struct io_uring_sqe *>(sqesMemory);
+
+        char *sq = static_cast<char *>(sqRing);
+        sqHead = reinterpret_cast<uint32_t *>(sq + params.sq_off.head);
+        sqTail = reinterpret_cast<uint32_t *>(sq + params.sq_off.tail);
+        sqMask = *reinterpret_cast<uint32_t *>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<uint32_t *>(sq + params.sq_off.array);
+
+        char *cq = static_cast<char *>(cqRing);
+        cqHead = reinterpret_cast<uint32_t *>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<uint32_t *>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<uint32_t *>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+    }
+
+    ~IoUring()
+    {
+        destroy();
+    }
+
+    bool valid() const
+    {
+        return sqes != NULL;
+    }
+
+    int fd() const
+    {
+        return ringFd;
+    }
+
+    // A zeroed submission entry, submitting the queue first if it is full.
+    struct io_uring_sqe *sqe()
+    {
+        uint32_t tail = *sqTail;
+
+        if( tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) == params.sq_entries )
+        {
+            enter(0, 0, NULL);
+            tail = *sqTail;
+        }
+
+        struct io_uring_sqe *entry = &sqes[tail & sqMask];
+        memset(entry, 0, sizeof(*entry));
+        sqArray[tail & sqMask] = tail & sqMask;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        ++queued;
+
+        return entry;
+    }
+
+    // Submit queued entries and wait up to `timeoutMs` for a completion.
+    void submitAndWait(unsigned timeoutMs)
+    {
+        struct __kernel_timespec ts;
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = (timeoutMs % 1000) * 1000000L;
+
+        enter(1, IORING_ENTER_GETEVENTS, &ts);
+    }
+
+    // The oldest unseen completion or NULL; call advance() when done.
+    struct io_uring_cqe *peek()
+    {
+        uint32_t head = *cqHead;
+
+        if( head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE) )
+            return NULL;
+
+        return &cqes[head & cqMask];
+    }
+
+    void advance()
+    {
+        __atomic_store_n(cqHead, *cqHead + 1, __ATOMIC_RELEASE);
+    }
+
+private:
+    IoUring(const IoUring &);
+    IoUring &operator=(const IoUring &);
+
+    void enter(unsigned waitFor, unsigned flags, struct __kernel_timespec *timeout)
+    {
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+
+        if( timeout )
+        {
+            arg.ts = reinterpret_cast<uintptr_t>(timeout);
+            flags |= IORING_ENTER_EXT_ARG;
+        }
+
+        int rc = static_cast<int>(syscall(__NR_io_uring_enter, ringFd, queued, waitFor, flags,
+                                          timeout ? &arg : NULL, timeout ? sizeof(arg) : 0));
+
+        if( rc >= 0 )
+            queued -= rc < static_cast<int>(queued) ? rc : queued;
+    }
+
+    void destroy()
+    {
+        if( sqes )
+            munmap(sqes, params.sq_entries * sizeof(struct io_uring_sqe));
+
+        if( cqRing != MAP_FAILED && cqRing != sqRing )
+            munmap(cqRing, cqRingSize);
+
+        if( sqRing != MAP_FAILED )
+            munmap(sqRing, sqRingSize);
+
+        if( ringFd >= 0 )
+            close(ringFd);
+
+        ringFd = -1;
+        sqRing = cqRing = MAP_FAILED;
+        sqes = NULL;
+    }
+
+    int ringFd;
+    struct io_uring_params params;
+
+    void *sqRing;
+    void *cqRing;
+    size_t sqRingSize;
+    size_t cqRingSize;
+    struct io_uring_sqe *sqes;
+    unsigned queued;
+
+    uint32_t *sqHead;
+    uint32_t *sqTail;
+    uint32_t sqMask;
+    uint32_t *sqArray;
+
+    uint32_t *cqHead;
+    uint32_t *cqTail;
+    uint32_t cqMask;
+    struct io_uring_cqe *cqes;
+};
+
+// Buffers the kernel picks from when a receive with IOSQE_BUFFER_SELECT
+// completes. The receiver reads the data in place and hands the buffer
+// back with recycle(). Buffers are provided with IORING_OP_PROVIDE_BUFFERS,
+// whose completions carry user_data 0; a negative result means the kernel
+// did not take them.
+class ProvidedBuffers
+{
+public:
+    ProvidedBuffers(IoUring &ring, uint16_t group, unsigned count, size_t bufferSize)
+        : ring(ring), group(group), bufferSize(bufferSize),
+          storage(static_cast<char *>(malloc(count * bufferSize)))
+    {
+        if( storage )
+            provide(storage, count, 0);
+    }
+
+    ~ProvidedBuffers()
+    {
+        free(storage);
+    }
+
+    bool valid() const
+    {
+        return storage != NULL;
+    }
+
+    uint16_t id() const
+    {
+        return group;
+    }
+
+    size_t size() const
+    {
+        return bufferSize;
+    }
+
+    const char *buffer(uint16_t bid) const
+    {
+        return storage + bid * bufferSize;
+    }
+
+    // Give a buffer back to the kernel; it goes with the next submission.
+    void recycle(uint16_t bid)
+    {
+        provide(storage + bid * bufferSize, 1, bid);
+    }
+
+private:
+    ProvidedBuffers(const ProvidedBuffers &);
+    ProvidedBuffers &operator=(const ProvidedBuffers &);
+
+    void provide(char *first, unsigned count, uint16_t bid)
+    {
+        struct io_uring_sqe *sqe = ring.sqe();
+        sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+        sqe->fd = static_cast<int>(count);
+        sqe->addr = reinterpret_cast<uintptr_t>(first);
+        sqe->len = static_cast<uint32_t>(bufferSize);
+        sqe->off = bid;
+        sqe->buf_group = group;
+    }
+
+    IoUring &ring;
+    uint16_t group;
+    size_t bufferSize;
+    char *storage;
+};
+
+#endif // HTTPPARSER_BENCHMARKS_IOURING_H
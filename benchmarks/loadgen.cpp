@@ -0,0 +1,361 @@
+/*
+ * Copyright (C) Alex Nekipelov (alex@nekipelov.net)
+ * License: MIT
+ */
+
+// Load generator for loopback benchmarks. Opens keep-alive connections to
+// a local port, keeps `depth` pipelined requests in flight on each, parses
+// the responses with HttpResponseParser and reports throughput and latency
+// percentiles.
+//
+//     loadgen [--port 8080] [--connections 64] [--threads 4] [--depth 1]
+//             [--duration 10] [--path /]
+//
+// Latency is measured from the moment a request is written to the moment
+// its response is parsed, so with pipelining it includes queueing behind
+// earlier requests on the same connection.
+
+#include <httpparser/response.h>
+#include <httpparser/httpresponseparser.h>
+
+#include "histogram.h"
+
+#include <deque>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace httpparser;
+
+static uint64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000u + ts.tv_nsec;
+}
+
+struct Options
+{
+    Options()
+        : port(8080), connections(64), threads(4), depth(1), duration(10), path("/")
+    {}
+
+    unsigned short port;
+    size_t connections;
+    size_t threads;
+    size_t depth;
+    unsigned duration;
+    std::string path;
+};
+
+struct Connection
+{
+    Connection() : fd(-1), written(0)
+    {}
+
+    int fd;
+    std::vector<char> input;
+    std::string output;
+    size_t written;
+    std::deque<uint64_t> sentAt;  // send time of each request in flight
+    HttpResponseParser parser;
+    Response response;
+};
+
+// One thread driving its share of the connections with its own epoll loop.
+class Worker
+{
+public:
+    Worker(const Options &options, size_t connectionCount)
+        : options(options), epollFd(epoll_create1(0)), conns(connectionCount),
+          responses(0), errors(0)
+    {
+        request = "GET " + options.path + " HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    }
+
+    ~Worker()
+    {
+        for(size_t i = 0; i < conns.size(); ++i)
+        {
+            if( conns[i].fd >= 0 )
+                close(conns[i].fd);
+        }
+
+        close(epollFd);
+    }
+
+    void run(uint64_t deadline)
+    {
+        for(size_t i = 0; i < conns.size(); ++i)
+            open(conns[i]);
+
+        struct epoll_event events[256];
+
+        while( nowNs() < deadline )
+        {
+            int count = epoll_wait(epollFd, events, 256, 10);
+
+            for(int i = 0; i < count; ++i)
+            {
+                Connection &conn = conns[events[i].data.u32];
+
+                if( conn.fd < 0 )
+                    continue;
+
+                if( (events[i].events & (EPOLLERR | EPOLLHUP)) || !readAll(conn) || !flush(conn) )
+                {
+                    ++errors;
+                    close(conn.fd);
+                    conn.fd = -1;
+                }
+            }
+        }
+    }
+
+    const Histogram &latency() const
+    {
+        return histogram;
+    }
+
+    uint64_t completed() const
+    {
+        return responses;
+    }
+
+    uint64_t failed() const
+    {
+        return errors;
+    }
+
+private:
+    void open(Connection &conn)
+    {
+        conn.fd = socket(AF_INET, SOCK_STREAM, 0);
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(options.port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        if( conn.fd < 0 || connect(conn.fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0 )
+        {
+            perror("connect");
+            exit(EXIT_FAILURE);
+        }
+
+        // Connect blocking, then switch to non-blocking for the loop.
+        fcntl(conn.fd, F_SETFL, fcntl(conn.fd, F_GETFL, 0) | O_NONBLOCK);
+
+        int on = 1;
+        setsockopt(conn.fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+        ev.data.u32 = static_cast<uint32_t>(&conn - &conns[0]);
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, conn.fd, &ev);
+
+        for(size_t i = 0; i < options.depth; ++i)
+            send(conn);
+
+        flush(conn);
+    }
+
+    void send(Connection &conn)
+    {
+        conn.output += request;
+        conn.sentAt.push_back(nowNs());
+    }
+
+    bool flush(Connection &conn)
+    {
+        while( conn.written < conn.output.size() )
+        {
+            ssize_t n = write(conn.fd, conn.output.data() + conn.written, conn.output.size() - conn.written);
+
+            if( n < 0 )
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+
+            conn.written += n;
+        }
+
+        conn.output.clear();
+        conn.written = 0;
+        return true;
+    }
+
+    bool readAll(Connection &conn)
+    {
+        char buffer[16 * 1024];
+
+        for(;;)
+        {
+            ssize_t n = read(conn.fd, buffer, sizeof(buffer));
+
+            if( n == 0 )
+                return false;
+            else if( n < 0 )
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+
+            conn.input.insert(conn.input.end(), buffer, buffer + n);
+
+            if( !parseAll(conn) )
+                return false;
+        }
+    }
+
+    bool parseAll(Connection &conn)
+    {
+        size_t used = 0;
+
+        while( used < conn.input.size() )
+        {
+            const char *begin = &conn.input[0] + used;
+            const char *end = &conn.input[0] + conn.input.size();
+
+            HttpResponseParser::ParseResult res = conn.parser.parse(conn.response, begin, end);
+            used += conn.parser.consumed();
+
+            if( res == HttpResponseParser::ParsingCompleted )
+            {
+                if( conn.sentAt.empty() || conn.response.statusCode != 200 )
+                    return false;
+
+                histogram.record(nowNs() - conn.sentAt.front());
+                conn.sentAt.pop_front();
+                ++responses;
+
+                conn.parser = HttpResponseParser();
+                conn.response.clear();
+                send(conn);
+            }
+            else if( res == HttpResponseParser::ParsingError )
+            {
+                return false;
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        conn.input.erase(conn.input.begin(), conn.input.begin() + used);
+        return true;
+    }
+
+    const Options &options;
+    int epollFd;
+    std::vector<Connection> conns;
+    std::string request;
+    Histogram histogram;
+    uint64_t responses;
+    uint64_t errors;
+};
+
+static bool parseArgs(int argc, char **argv, Options &options)
+{
+    for(int i = 1; i + 1 < argc; i += 2)
+    {
+        const char *value = argv[i + 1];
+
+        if( strcmp(argv[i], "--port") == 0 )
+            options.port = static_cast<unsigned short>(atoi(value));
+        else if( strcmp(argv[i], "--connections") == 0 )
+            options.connections = strtoul(value, NULL, 10);
+        else if( strcmp(argv[i], "--threads") == 0 )
+            options.threads = strtoul(value, NULL, 10);
+        else if( strcmp(argv[i], "--depth") == 0 )
+            options.depth = strtoul(value, NULL, 10);
+        else if( strcmp(argv[i], "--duration") == 0 )
+            options.duration = static_cast<unsigned>(atoi(value));
+        else if( strcmp(argv[i], "--path") == 0 )
+            options.path = value;
+        else
+            return false;
+    }
+
+    return argc % 2 == 1 && options.connections > 0 && options.threads > 0 && options.depth > 0;
+}
+
+static void printLatency(const char *name, uint64_t ns)
+{
+    std::cout << "  " << name << ": " << ns / 1000.0 << " us" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+
+    if( !parseArgs(argc, argv, options) )
+    {
+        std::cerr << "usage: " << argv[0] << " [--port N] [--connections N] [--threads N]"
+                  << " [--depth N] [--duration SECONDS] [--path PATH]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    if( options.threads > options.connections )
+        options.threads = options.connections;
+
+    std::vector<Worker *> workers;
+
+    for(size_t i = 0; i < options.threads; ++i)
+    {
+        size_t share = options.connections / options.threads + (i < options.connections % options.threads ? 1 : 0);
+        workers.push_back(new Worker(options, share));
+    }
+
+    uint64_t start = nowNs();
+    uint64_t deadline = start + static_cast<uint64_t>(options.duration) * 1000000000u;
+    std::vector<std::thread> threads;
+
+    for(size_t i = 0; i < workers.size(); ++i)
+        threads.push_back(std::thread(&Worker::run, workers[i], deadline));
+
+    for(size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+
+    double elapsed = (nowNs() - start) / 1e9;
+    Histogram latency;
+    uint64_t completed = 0;
+    uint64_t failed = 0;
+
+    for(size_t i = 0; i < workers.size(); ++i)
+    {
+        latency.merge(workers[i]->latency());
+        completed += workers[i]->completed();
+        failed += workers[i]->failed();
+        delete workers[i];
+    }
+
+    std::cout << options.connections << " connections, " << options.threads << " threads, depth "
+              << options.depth << ", " << elapsed << " s" << std::endl;
+    std::cout << "requests: " << completed << " (" << completed / elapsed << " req/s), failed connections: "
+              << failed << std::endl;
+    std::cout << "latency:" << std::endl;
+    printLatency("mean", static_cast<uint64_t>(latency.mean()));
+    printLatency("p50", latency.percentile(50));
+    printLatency("p90", latency.percentile(90));
+    printLatency("p99", latency.percentile(99));
+    printLatency("p99.9", latency.percentile(99.9));
+    printLatency("max", latency.max());
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) Alex Nekipelov (alex@nekipelov.net)
+ * License: MIT
+ */
+
+// Parses a mix of typical requests and responses many times and prints the
+// throughput. Built once per dispatch backend (parserbench and
+// parserbench_goto) so the two can be compared on the same machine.
+//
+// The "connections" runs parse one request for each of many connections
+// whose parser, message and input are spread over more memory than the
+// caches hold, in a shuffled order, once one by one and once through
+// BatchParser with prefetching.
+
+#include <httpparser/request.h>
+#include <httpparser/response.h>
+#include <httpparser/httprequestparser.h>
+#include <httpparser/httpresponseparser.h>
+#include <httpparser/batchparser.h>
+
+#include <algorithm>
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+using namespace httpparser;
+
+static const char *requests[] = {
+    "GET /index.html HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Gecko/20100101 Firefox/115.0\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n",
+
+    "POST /api/v1/items?debug=1 HTTP/1.1\r\n"
+    "Host: api.example.com\r\n"
+    "Content-Type: application/json\r\n"
+    "Content-Length: 27\r\n"
+    "\r\n"
+    "{\"name\":\"item\",\"count\":42}\n",
+
+    "GET /favicon.ico HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "\r\n"
+};
+
+static const char *responses[] = {
+    "HTTP/1.1 200 OK\r\n"
+    "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+    "Server: Apache\r\n"
+    "Content-Type: text/html; charset=UTF-8\r\n"
+    "Content-Length: 12\r\n"
+    "\r\n"
+    "Hello world!",
+
+    "HTTP/1.1 200 OK\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "\r\n"
+    "5\r\nhello\r\n7\r\n, world\r\n0\r\n\r\n",
+
+    "HTTP/1.1 304 Not Modified\r\n"
+    "ETag: \"33a64df551425fcc55e4d42a148795d9f25f89d4\"\r\n"
+    "\r\n"
+};
+
+static double seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+template<typename Parser, typename Message>
+static void run(const char *name, const char **texts, size_t count, size_t iterations)
+{
+    std::vector<std::string> messages(texts, texts + count);
+    size_t bytes = 0;
+    size_t failures = 0;
+
+    double start = seconds();
+
+    for(size_t i = 0; i < iterations; ++i)
+    {
+        const std::string &text = messages[i % count];
+        Message msg;
+        Parser parser;
+
+        if( parser.parse(msg, text.data(), text.data() + text.size()) != Parser::ParsingCompleted )
+            ++failures;
+
+        bytes += text.size();
+    }
+
+    double elapsed = seconds() - start;
+
+    std::cout << name << ": "
+              << elapsed * 1e9 / iterations << " ns/message, "
+              << bytes / elapsed / (1024 * 1024) << " MiB/s";
+
+    if( failures )
+        std::cout << " (" << failures << " failures)";
+
+    std::cout << std::endl;
+}
+
+// What a server keeps per connection.
+struct ConnectionState
+{
+    HttpRequestParser parser;
+    Request req;
+    std::vector<char> input;
+    size_t size;
+};
+
+static void runConnections(const char **texts, size_t count, size_t connections, size_t rounds)
+{
+    typedef BatchParser<HttpRequestParser, Request> Batch;
+
+    // Allocated one by one and visited in random order, as a server would
+    // find them after epoll_wait().
+    std::vector<ConnectionState *> states(connections);
+
+    for(size_t i = 0; i < connections; ++i)
+    {
+        const char *text = texts[i % count];
+        states[i] = new ConnectionState;
+        states[i]->size = strlen(text);
+        states[i]->input.assign(text, text + states[i]->size);
+        states[i]->input.resize(2048);
+    }
+
+    std::mt19937 random(1);
+    std::shuffle(states.begin(), states.end(), random);
+
+    std::vector<Batch::Job> jobs(connections);
+    double elapsed[2] = { 0, 0 };
+    size_t failures = 0;
+
+    for(size_t round = 0; round < rounds; ++round)
+    {
+        // Alternate which goes first; the second pass of a round runs a
+        // little slower whichever it is.
+        for(int pass = 0; pass < 2; ++pass)
+        {
+            int batched = (round + pass) % 2;
+
+            for(size_t i = 0; i < connections; ++i)
+            {
+                jobs[i].parser = &states[i]->parser;
+                jobs[i].message = &states[i]->req;
+                jobs[i].begin = &states[i]->input[0];
+                jobs[i].end = jobs[i].begin + states[i]->size;
+            }
+
+            double start = seconds();
+
+            if( batched )
+            {
+                Batch::parse(jobs);
+            }
+            else
+            {
+                for(size_t i = 0; i < connections; ++i)
+                {
+                    jobs[i].result = jobs[i].parser->parse(*jobs[i].message, jobs[i].begin, jobs[i].end);
+                    jobs[i].begin += jobs[i].parser->consumed();
+                }
+            }
+
+            elapsed[batched] += seconds() - start;
+
+            for(size_t i = 0; i < connections; ++i)
+            {
+                if( jobs[i].result != HttpRequestParser::ParsingCompleted )
+                    ++failures;
+
+                *jobs[i].parser = HttpRequestParser();
+                jobs[i].message->clear();
+            }
+
+            // The states take far more memory than the caches hold; a new
+            // order keeps the hardware prefetcher from learning this one.
+            std::shuffle(states.begin(), states.end(), random);
+        }
+    }
+
+    for(size_t i = 0; i < connections; ++i)
+        delete states[i];
+
+    const char *names[2] = { "connections, one by one", "connections, batched" };
+
+    for(int batched = 0; batched < 2; ++batched)
+    {
+        std::cout << names[batched] << ": "
+                  << elapsed[batched] * 1e9 / (connections * rounds) << " ns/message";
+
+        if( failures )
+            std::cout << " (" << failures << " failures)";
+
+        std::cout << std::endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t iterations = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+
+#ifdef HTTPPARSER_COMPUTED_GOTO
+    std::cout << "dispatch: computed goto" << std::endl;
+#else
+    std::cout << "dispatch: switch" << std::endl;
+#endif
+
+    run<HttpRequestParser, Request>("requests", requests, sizeof(requests) / sizeof(requests[0]), iterations);
+    run<HttpResponseParser, Response>("responses", responses, sizeof(responses) / sizeof(responses[0]), iterations);
+    runConnections(requests, sizeof(requests) / sizeof(requests[0]), 65536, iterations / 65536 + 1);
+
+    return 0;
+}
@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) Alex Nekipelov (alex@nekipelov.net)
+ * License: MIT
+ */
+
+#ifndef HTTPPARSER_BENCHMARKS_RINGQUEUE_H
+#define HTTPPARSER_BENCHMARKS_RINGQUEUE_H
+
+#include <atomic>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bounded lock-free queues for handing parsed messages (usually
+// ParserPool entries) between the threads of the benchmark server. Both
+// have a fixed power-of-two capacity, never allocate after construction,
+// and fail a push instead of blocking when full, so the caller decides
+// whether to retry, shed load or handle the item itself. popBatch() takes up to `max` items at once,
+// which is what keeps the consumer's share of the cost low under load.
+//
+// Head and tail sit on separate cache lines so that the producer and the
+// consumer do not invalidate each other's line on every operation.
+
+// One producer thread, one consumer thread.
+template<typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(size_t capacity)
+        : items(roundUp(capacity)), mask(items.size() - 1), head(0), cachedTail(0), tail(0), cachedHead(0)
+    {
+    }
+
+    // Producer side. Returns false if the queue is full.
+    bool push(const T &item)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+
+        if( t - cachedHead == items.size() )
+        {
+            cachedHead = head.load(std::memory_order_acquire);
+
+            if( t - cachedHead == items.size() )
+                return false;
+        }
+
+        items[t & mask] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Moves up to `max` items to `out` and returns how many.
+    size_t popBatch(T *out, size_t max)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+
+        if( cachedTail - h < max )
+            cachedTail = tail.load(std::memory_order_acquire);
+
+        size_t count = cachedTail - h < max ? cachedTail - h : max;
+
+        for(size_t i = 0; i < count; ++i)
+            out[i] = items[(h + i) & mask];
+
+        if( count > 0 )
+            head.store(h + count, std::memory_order_release);
+
+        return count;
+    }
+
+    bool pop(T &item)
+    {
+        return popBatch(&item, 1) == 1;
+    }
+
+    // Exact only when called from the consumer or the producer thread
+    // while the other side is idle.
+    bool empty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const
+    {
+        return items.size();
+    }
+
+private:
+    SpscQueue(const SpscQueue &);
+    SpscQueue &operator=(const SpscQueue &);
+
+    static size_t roundUp(size_t n)
+    {
+        size_t size = 2;
+
+        while( size < n )
+            size *= 2;
+
+        return size;
+    }
+
+    enum {
+        cacheLine = 64
+    };
+
+    std::vector<T> items;
+    size_t mask;
+
+    // Consumer's line: its position and its view of the producer's.
+    alignas(cacheLine) std::atomic<size_t> head;
+    size_t cachedTail;
+
+    // Producer's line.
+    alignas(cacheLine) std::atomic<size_t> tail;
+    size_t cachedHead;
+};
+
+// Any number of producer and consumer threads. Every slot carries a
+// sequence number telling whose turn it is (Vyukov's bounded queue), so
+// a push or a pop is one compare-and-swap on the shared position; a batch
+// pop claims all of its slots with a single one.
+template<typename T>
+class MpmcQueue
+{
+public:
+    explicit MpmcQueue(size_t capacity)
+        : size(roundUp(capacity)), mask(size - 1), cells(new Cell[size]), head(0), tail(0)
+    {
+        for(size_t i = 0; i < size; ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    ~MpmcQueue()
+    {
+        delete [] cells;
+    }
+
+    // Returns false if the queue is full.
+    bool push(const T &item)
+    {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        Cell *cell;
+
+        for(;;)
+        {
+            cell = &cells[pos & mask];
+            intptr_t diff = static_cast<intptr_t>(cell->sequence.load(std::memory_order_acquire)) -
+                            static_cast<intptr_t>(pos);
+
+            if( diff == 0 )
+            {
+                if( tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed) )
+                    break;
+            }
+            else if( diff < 0 )
+            {
+                return false;
+            }
+            else
+            {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = item;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Moves up to `max` items to `out` and returns how many.
+    size_t popBatch(T *out, size_t max)
+    {
+        size_t pos = head.load(std::memory_order_relaxed);
+        size_t count;
+
+        for(;;)
+        {
+            // Count the filled slots in a row from `pos`, then claim them
+            // all at once.
+            count = 0;
+
+            while( count < max &&
+                   cells[(pos + count) & mask].sequence.load(std::memory_order_acquire) == pos + count + 1 )
+            {
+                ++count;
+            }
+
+            if( count == 0 )
+            {
+                size_t current = head.load(std::memory_order_relaxed);
+
+                if( current == pos )
+                    return 0;
+
+                pos = current;
+                continue;
+            }
+
+            if( head.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed) )
+                break;
+        }
+
+        for(size_t i = 0; i < count; ++i)
+        {
+            Cell &cell = cells[(pos + i) & mask];
+            out[i] = cell.value;
+            cell.sequence.store(pos + i + size, std::memory_order_release);
+        }
+
+        return count;
+    }
+
+    bool pop(T &item)
+    {
+        return popBatch(&item, 1) == 1;
+    }
+
+    size_t capacity() const
+    {
+        return size;
+    }
+
+private:
+    MpmcQueue(const MpmcQueue &);
+    MpmcQueue &operator=(const MpmcQueue &);
+
+    static size_t roundUp(size_t n)
+    {
+        size_t result = 2;
+
+        while( result < n )
+            result *= 2;
+
+        return result;
+    }
+
+    enum {
+        cacheLine = 64
+    };
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    size_t size;
+    size_t mask;
+    Cell *cells;
+
+    alignas(cacheLine) std::atomic<size_t> head;
+    alignas(cacheLine) std::atomic<size_t> tail;
+};
+
+#endif // HTTPPARSER_BENCHMARKS_RINGQUEUE_H
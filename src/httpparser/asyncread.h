@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) Alex Nekipelov (alex@nekipelov.net)
+ * License: MIT
+ */
+
+#ifndef HTTPPARSER_ASYNCREAD_H
+#define HTTPPARSER_ASYNCREAD_H
+
+#include <httpparser/request.h>
+#include <httpparser/response.h>
+#include <httpparser/httprequestparser.h>
+#include <httpparser/httpresponseparser.h>
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/compose.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <stddef.h>
+
+namespace httpparser
+{
+
+namespace detail
+{
+
+// Composed operation behind async_read_request() and async_read_response():
+// parse what the buffer already holds, then read and parse until one
+// message is complete. Bytes the parser used are consumed from the buffer
+// as it goes, so what stays behind is exactly what follows the message.
+template <typename AsyncReadStream, typename Parser, typename Message>
+class AsyncReadMessage
+{
+public:
+    AsyncReadMessage(AsyncReadStream &stream, boost::asio::streambuf &buffer, Message &message)
+        : stream(stream), buffer(buffer), message(message), state(Starting), total(0)
+    {
+    }
+
+    template <typename Self>
+    void operator()(Self &self, boost::system::error_code ec = boost::system::error_code(), size_t bytes = 0)
+    {
+        switch( state )
+        {
+        case Starting:
+            state = Reading;
+
+            // A pipelined message may already be buffered. The handler
+            // must not run inside the initiating call, so finish from a
+            // posted continuation.
+            if( parseBuffered() )
+            {
+                state = Finished;
+                boost::asio::post(stream.get_executor(), std::move(self));
+                return;
+            }
+            break;
+        case Reading:
+            if( ec )
+            {
+                self.complete(ec, total);
+                return;
+            }
+
+            buffer.commit(bytes);
+
+            if( parseBuffered() )
+            {
+                self.complete(result, total);
+                return;
+            }
+            break;
+        case Finished:
+            self.complete(result, total);
+            return;
+        }
+
+        // Found through ADL; the streambuf declares it as a friend.
+        size_t size = read_size_helper(buffer, readSize);
+
+        if( size == 0 )
+        {
+            self.complete(boost::asio::error::no_buffer_space, total);
+            return;
+        }
+
+        stream.async_read_some(buffer.prepare(size), std::move(self));
+    }
+
+private:
+    // Feed the buffered bytes to the parser. Returns true once the message
+    // is complete or malformed, with `result` set.
+    bool parseBuffered()
+    {
+        if( buffer.size() == 0 )
+            return false;
+
+        const char *begin = static_cast<const char *>(buffer.data().data());
+        const char *end = begin + buffer.size();
+
+        typename Parser::ParseResult res = parser.parse(message, begin, end);
+
+        total += parser.consumed();
+        buffer.consume(parser.consumed());
+
+        if( res == Parser::ParsingCompleted )
+        {
+            result = boost::system::error_code();
+            return true;
+        }
+        else if( res == Parser::ParsingError )
+        {
+            result = boost::system::errc::make_error_code(boost::system::errc::bad_message);
+            return true;
+        }
+
+        return false;
+    }
+
+    enum State {
+        Starting,
+        Reading,
+        Finished
+    };
+
+    enum {
+        readSize = 64 * 1024
+    };
+
+    AsyncReadStream &stream;
+    boost::asio::streambuf &buffer;
+    Message &message;
+    Parser parser;
+    State state;
+    size_t total;
+    boost::system::error_code result;
+};
+
+} // namespace detail
+
+// Read one request from `stream` into `req` (cleared first, keeping its
+// capacity). `buffer` carries bytes between calls: it may already hold
+// the start of the request, and on completion it holds whatever the peer
+// pipelined after it, so the same buffer must be passed to the next call.
+//
+// The handler is called as void(boost::system::error_code, size_t) with
+// the number of bytes the request took. A malformed request completes
+// with errc::bad_message and a full buffer with error::no_buffer_space;
+// read errors, including eof, are passed through.
+template <typename AsyncReadStream, typename ReadHandler>
+BOOST_ASIO_INITFN_RESULT_TYPE(ReadHandler, void(boost::system::error_code, size_t))
+async_read_request(AsyncReadStream &stream, boost::asio::streambuf &buffer, Request &req,
+                   ReadHandler &&handler)
+{
+    req.clear();
+
+    return boost::asio::async_compose<ReadHandler, void(boost::system::error_code, size_t)>(
+        detail::AsyncReadMessage<AsyncReadStream, HttpRequestParser, Request>(stream, buffer, req),
+        handler, stream);
+}
+
+// The same for a response; see async_read_request().
+template <typename AsyncReadStream, typename ReadHandler>
+BOOST_ASIO_INITFN_RESULT_TYPE(ReadHandler, void(boost::system::error_code, size_t))
+async_read_response(AsyncReadStream &stream, boost::asio::streambuf &buffer, Response &resp,
+                    ReadHandler &&handler)
+{
+    resp.clear();
+
+    return boost::asio::async_compose<ReadHandler, void(boost::system::error_code, size_t)>(
+        detail::AsyncReadMessage<AsyncReadStream, HttpResponseParser, Response>(stream, buffer, resp),
+        handler, stream);
+}
+
+} // namespace httpparser
+
+#endif // HTTPPARSER_ASYNCREAD_H
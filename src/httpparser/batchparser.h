@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) Alex Nekipelov (alex@nekipelov.net)
+ * License: MIT
+ */
+
+#ifndef HTTPPARSER_BATCHPARSER_H
+#define HTTPPARSER_BATCHPARSER_H
+
+#include <vector>
+
+#include <stddef.h>
+
+#if defined(__GNUC__)
+#define HTTPPARSER_PREFETCH(address, write) __builtin_prefetch((address), (write))
+#else
+#define HTTPPARSER_PREFETCH(address, write) ((void)0)
+#endif
+
+namespace httpparser
+{
+
+// Parses the input of many connections in one pass, e.g. everything an
+// event loop read after one wake-up. With hundreds of connections the
+// input, the parser and the message of each one are usually out of cache
+// by the time it is parsed, so while parsing one job the parser prefetches
+// all three for the job 2 * `distance` places ahead, and the header storage
+// of the message, found through the now cached message object, for the job
+// `distance` places ahead. Each job is parsed once, up to the end of its
+// first message; a caller with pipelined input handles the completed
+// messages and runs the batch again on the jobs with input left, which
+// interleaves the connections message by message:
+//
+//     typedef BatchParser<HttpRequestParser, Request> Batch;
+//     std::vector<Batch::Job> jobs;  // one per readable connection
+//
+//     while( !jobs.empty() )
+//     {
+//         Batch::parse(jobs);
+//         ... handle jobs[i].message where jobs[i].result is
+//             ParsingCompleted, reset its parser and message, and drop
+//             the jobs with no input left ...
+//     }
+template<typename Parser, typename Message>
+class BatchParser
+{
+public:
+    typedef typename Parser::ParseResult ParseResult;
+
+    // One connection's turn. parse() sets `result` and moves `begin` past
+    // the bytes the parser used. A job without input is left alone, with
+    // ParsingIncompleted as its result.
+    struct Job
+    {
+        Parser *parser;
+        Message *message;
+        const char *begin;
+        const char *end;
+        ParseResult result;
+    };
+
+    enum {
+        // Jobs between the one being parsed and the one being prefetched.
+        distance = 4,
+        // Input prefetched per job; the hardware prefetcher takes over
+        // once the parser walks past it.
+        prefetchBytes = 256,
+        // Header slots prefetched per job.
+        prefetchHeaders = 8,
+        cacheLine = 64
+    };
+
+    static void parse(Job *jobs, size_t count)
+    {
+        for(size_t i = 0; i < count && i < 2 * distance; ++i)
+            prefetch(jobs[i]);
+
+        for(size_t i = 0; i < count && i < distance; ++i)
+            prefetchStorage(jobs[i]);
+
+        for(size_t i = 0; i < count; ++i)
+        {
+            if( i + 2 * distance < count )
+                prefetch(jobs[i + 2 * distance]);
+
+            if( i + distance < count )
+                prefetchStorage(jobs[i + distance]);
+
+            Job &job = jobs[i];
+
+            if( job.begin == job.end )
+            {
+                job.result = Parser::ParsingIncompleted;
+                continue;
+            }
+
+            job.result = job.parser->parse(*job.message, job.begin, job.end);
+            job.begin += job.parser->consumed();
+        }
+    }
+
+    static void parse(std::vector<Job> &jobs)
+    {
+        if( !jobs.empty() )
+            parse(&jobs[0], jobs.size());
+    }
+
+private:
+    // First stage: the job's input and the parser and message objects.
+    static void prefetch(const Job &job)
+    {
+        if( job.begin == job.end )
+            return;
+
+        prefetchObject(job.parser, sizeof(Parser));
+        prefetchObject(job.message, sizeof(Message));
+
+        size_t size = job.end - job.begin;
+
+        for(size_t offset = 0; offset < size && offset < prefetchBytes; offset += cacheLine)
+            HTTPPARSER_PREFETCH(job.begin + offset, 0);
+    }
+
+    // Second stage, once the message object is in cache: the memory it
+    // owns that parsing fills in, above all the header slots kept from the
+    // previous message.
+    static void prefetchStorage(const Job &job)
+    {
+        if( job.begin == job.end )
+            return;
+
+        const Message &msg = *job.message;
+        size_t headers = msg.headers.capacity();
+
+        if( headers > static_cast<size_t>(prefetchHeaders) )
+            headers = prefetchHeaders;
+
+        if( headers > 0 )
+            prefetchObject(msg.headers.data(), headers * sizeof(msg.headers[0]));
+
+        if( msg.content.capacity() > 0 )
+            HTTPPARSER_PREFETCH(msg.content.data(), 1);
+    }
+
+    // Both are written while parsing. The last byte covers the line an
+    // unaligned object spills into.
+    static void prefetchObject(const void *object, size_t size)
+    {
+        const char *p = static_cast<const char *>(object);
+
+        for(size_t offset = 0; offset < size; offset += cacheLine)
+            HTTPPARSER_PREFETCH(p + offset, 1);
+
+        HTTPPARSER_PREFETCH(p + size - 1, 1);
+    }
+};
+
+} // namespace httpparser
+
+#endif // HTTPPARSER_BATCHPARSER_H
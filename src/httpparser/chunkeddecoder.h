@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) Alex Nekipelov (alex@nekipelov.net)
+ * License: MIT
+ */
+
+#ifndef HTTPPARSER_CHUNKEDDECODER_H
+#define HTTPPARSER_CHUNKEDDECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace httpparser
+{
+
+// Removes chunked transfer-coding framing in place, inside a buffer owned
+// by the caller, instead of copying the payload into Request::content or
+// Response::content. Chunk extensions and trailers are skipped.
+//
+// The decoder is resumable: feed each newly received part of the body
+// to decode() and keep the decoded bytes it leaves at the front.
+class ChunkedDecoder
+{
+public:
+    ChunkedDecoder()
+        : state(ChunkSize), chunkSize(0), hasSizeDigits(false), leftoverSize(0)
+    {
+    }
+
+    enum ParseResult {
+        ParsingCompleted,
+        ParsingIncompleted,
+        ParsingError
+    };
+
+    // Decode [buf, buf + size) in place. On return `size` is the number of
+    // payload bytes compacted to the front of `buf`. Once the last chunk
+    // and trailers are seen the result is ParsingCompleted and any bytes
+    // that follow the body (e.g. a pipelined message) are moved right
+    // after the payload; leftover() tells how many.
+    ParseResult decode(char *buf, size_t &size)
+    {
+        char *dst = buf;
+        const char *src = buf;
+        const char *end = buf + size;
+
+        leftoverSize = 0;
+
+        while( src != end )
+        {
+            if( state == ChunkData )
+            {
+                size_t count = static_cast<size_t>(end - src);
+
+                if( count > chunkSize )
+                    count = chunkSize;
+
+                if( dst != src )
+                    memmove(dst, src, count);
+
+                dst += count;
+                src += count;
+                chunkSize -= count;
+
+                if( chunkSize == 0 )
+                    state = ChunkDataNewLine_1;
+
+                continue;
+            }
+
+            char input = *src++;
+
+            switch( state )
+            {
+            case ChunkSize:
+                if( isHexDigit(input) )
+                {
+                    if( chunkSize > (SIZE_MAX >> 4) )
+                        return ParsingError;
+
+                    chunkSize = chunkSize * 16 + hexValue(input);
+                    hasSizeDigits = true;
+                }
+                else if( !hasSizeDigits )
+                {
+                    return ParsingError;
+                }
+                else if( input == ';' || input == ' ' || input == '\t' )
+                {
+                    state = ChunkExtension;
+                }
+                else if( input == '\r' )
+                {
+                    state = ChunkSizeNewLine;
+                }
+                else
+                {
+                    return ParsingError;
+                }
+                break;
+            case ChunkExtension:
+                if( input == '\r' )
+                    state = ChunkSizeNewLine;
+                else if( input == '\n' )
+                    return ParsingError;
+                break;
+            case ChunkSizeNewLine:
+                if( input != '\n' )
+                    return ParsingError;
+
+                hasSizeDigits = false;
+                state = chunkSize == 0 ? TrailerLineStart : ChunkData;
+                break;
+            case ChunkDataNewLine_1:
+                if( input != '\r' )
+                    return ParsingError;
+
+                state = ChunkDataNewLine_2;
+                break;
+            case ChunkDataNewLine_2:
+                if( input != '\n' )
+                    return ParsingError;
+
+                state = ChunkSize;
+                break;
+            case TrailerLineStart:
+                state = input == '\r' ? FinalNewLine : TrailerLine;
+                break;
+            case TrailerLine:
+                if( input == '\r' )
+                    state = TrailerNewLine;
+                else if( input == '\n' )
+                    return ParsingError;
+                break;
+            case TrailerNewLine:
+                if( input != '\n' )
+                    return ParsingError;
+
+                state = TrailerLineStart;
+                break;
+            case FinalNewLine:
+                if( input != '\n' )
+                    return ParsingError;
+
+                leftoverSize = static_cast<size_t>(end - src);
+
+                if( dst != src )
+                    memmove(dst, src, leftoverSize);
+
+                state = Done;
+                size = static_cast<size_t>(dst - buf);
+                return ParsingCompleted;
+            case ChunkData:
+            case Done:
+                return ParsingError;
+            }
+        }
+
+        size = static_cast<size_t>(dst - buf);
+        return state == Done ? ParsingCompleted : ParsingIncompleted;
+    }
+
+    // Number of bytes after the body that the last decode() call kept.
+    size_t leftover() const
+    {
+        return leftoverSize;
+    }
+
+    // Prepare for the next body.
+    void reset()
+    {
+        state = ChunkSize;
+        chunkSize = 0;
+        hasSizeDigits = false;
+        leftoverSize = 0;
+    }
+
+private:
+    static bool isHexDigit(char c)
+    {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+    }
+
+    static size_t hexValue(char c)
+    {
+        if( c >= '0' && c <= '9' )
+            return c - '0';
+        else if( c >= 'a' && c <= 'f' )
+            return c - 'a' + 10;
+        else
+            return c - 'A' + 10;
+    }
+
+    enum State
+    {
+        ChunkSize,
+        ChunkExtension,
+        ChunkSizeNewLine,
+        ChunkData,
+        ChunkDataNewLine_1,
+        ChunkDataNewLine_2,
+        TrailerLineStart,
+        TrailerLine,
+        TrailerNewLine,
+        FinalNewLine,
+        Done
+    } state;
+
+    size_t chunkSize;
+    bool hasSizeDigits;
+    size_t leftoverSize;
+};
+
+} // namespace httpparser
+
+#endif // HTTPPARSER_CHUNKEDDECODER_H
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) Alex Nekipelov (alex@nekipelov.net)
+ * License: MIT
+ */
+
+#ifndef HTTPPARSER_CHUNKEDENCODER_H
+#define HTTPPARSER_CHUNKEDENCODER_H
+
+#include <string>
+#include <vector>
+
+#include <string.h>
+#include <sys/uio.h>
+
+namespace httpparser
+{
+
+// Frames a body produced piece by piece with the chunked transfer coding
+// (RFC 7230, section 4.1). The message head must carry
+// "Transfer-Encoding: chunked" and no Content-Length.
+//
+// The gather functions describe the framing as iovec entries around the
+// caller's payload, so payload bytes are never copied. Chunk size lines
+// are written into storage supplied by the caller, which must stay alive
+// until the entries are written out.
+class ChunkedEncoder
+{
+public:
+    enum {
+        // Hex digits of the largest size_t plus CRLF.
+        maxSizeLineSize = sizeof(size_t) * 2 + 2,
+
+        // Entries used by gatherChunk().
+        chunkIovecCount = 3
+    };
+
+    // Write "<hex size>\r\n" to `out` and return its length.
+    static size_t sizeLine(size_t size, char *out)
+    {
+        static const char digits[] = "0123456789ABCDEF";
+
+        size_t count = 1;
+
+        for(size_t rest = size >> 4; rest != 0; rest >>= 4)
+            ++count;
+
+        for(size_t i = count; i > 0; --i)
+        {
+            out[i - 1] = digits[size & 0xf];
+            size >>= 4;
+        }
+
+        out[count] = '\r';
+        out[count + 1] = '\n';
+
+        return count + 2;
+    }
+
+    // Describe one chunk carrying [data, data + size) as three entries:
+    // the size line (rendered into `sizeLineStorage`, which must hold
+    // maxSizeLineSize bytes), the payload and the trailing CRLF. An empty
+    // chunk would end the body, so nothing is emitted for size == 0 and
+    // the function returns 0.
+    static size_t gatherChunk(const char *data, size_t size, char *sizeLineStorage, struct iovec *iov)
+    {
+        if( size == 0 )
+            return 0;
+
+        set(iov[0], sizeLineStorage, sizeLine(size, sizeLineStorage));
+        set(iov[1], data, size);
+        set(iov[2], "\r\n", 2);
+
+        return chunkIovecCount;
+    }
+
+    // Number of entries gatherLastChunk() needs.
+    template<typename HeaderItem>
+    static size_t lastChunkIovecCount(const std::vector<HeaderItem> &trailers)
+    {
+        return 2 + trailers.size() * 4;
+    }
+
+    // Describe the last chunk followed by `trailers` and the final CRLF.
+    // Returns the number of entries used, or 0 if `count` is too small.
+    template<typename HeaderItem>
+    static size_t gatherLastChunk(const std::vector<HeaderItem> &trailers, struct iovec *iov, size_t count)
+    {
+        if( count < lastChunkIovecCount(trailers) )
+            return 0;
+
+        if( trailers.empty() )
+        {
+            set(iov[0], "0\r\n\r\n", 5);
+            return 1;
+        }
+
+        size_t n = 0;
+
+        set(iov[n++], "0\r\n", 3);
+
+        for(typename std::vector<HeaderItem>::const_iterator it = trailers.begin();
+            it != trailers.end(); ++it)
+        {
+            set(iov[n++], it->name.data(), it->name.size());
+            set(iov[n++], ": ", 2);
+            set(iov[n++], it->value.data(), it->value.size());
+            set(iov[n++], "\r\n", 2);
+        }
+
+        set(iov[n++], "\r\n", 2);
+
+        return n;
+    }
+
+    // The last chunk without trailers, always a single entry.
+    static size_t gatherLastChunk(struct iovec *iov)
+    {
+        set(iov[0], "0\r\n\r\n", 5);
+        return 1;
+    }
+
+    // Append one chunk to `out`; nothing is appended for size == 0.
+    static void appendChunk(std::vector<char> &out, const char *data, size_t size)
+    {
+        if( size == 0 )
+            return;
+
+        char line[maxSizeLineSize];
+        size_t lineSize = sizeLine(size, line);
+        size_t offset = out.size();
+
+        out.resize(offset + lineSize + size + 2);
+
+        char *ptr = &out[0] + offset;
+        memcpy(ptr, line, lineSize);
+        memcpy(ptr + lineSize, data, size);
+        memcpy(ptr + lineSize + size, "\r\n", 2);
+    }
+
+    template<typename HeaderItem>
+    static void appendLastChunk(std::vector<char> &out, const std::vector<HeaderItem> &trailers)
+    {
+        append(out, "0\r\n", 3);
+
+        for(typename std::vector<HeaderItem>::const_iterator it = trailers.begin();
+            it != trailers.end(); ++it)
+        {
+            append(out, it->name.data(), it->name.size());
+            append(out, ": ", 2);
+            append(out, it->value.data(), it->value.size());
+            append(out, "\r\n", 2);
+        }
+
+        append(out, "\r\n", 2);
+    }
+
+    static void appendLastChunk(std::vector<char> &out)
+    {
+        append(out, "0\r\n\r\n", 5);
+    }
+
+private:
+    static void set(struct iovec &iov, const char *data, size_t size)
+    {
+        iov.iov_base = const_cast<char *>(data);
+        iov.iov_len = size;
+    }
+
+    static void append(std::vector<char> &out, const char *data, size_t size)
+    {
+        out.insert(out.end(), data, data + size);
+    }
+};
+
+} // namespace httpparser
+
+#endif // HTTPPARSER_CHUNKEDENCODER_H
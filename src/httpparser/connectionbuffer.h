@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) Alex Nekipelov (alex@nekipelov.net)
+ * License: MIT
+ */
+
+#ifndef HTTPPARSER_CONNECTIONBUFFER_H
+#define HTTPPARSER_CONNECTIONBUFFER_H
+
+#include <vector>
+
+#include <stddef.h>
+#include <string.h>
+
+namespace httpparser
+{
+
+// The input buffer of one connection: received bytes go in at the end,
+// the parser takes them from the front, and whatever it leaves (the start
+// of the next message, or a whole head with setWaitForHead()) stays for
+// the next round.
+//
+//     ConnectionBuffer buffer;
+//
+//     for(;;)
+//     {
+//         if( buffer.prepare() == 0 )
+//             ... the message does not fit in maxCapacity, reject it ...
+//
+//         ssize_t n = read(fd, buffer.writeBegin(), buffer.writable());
+//         ...
+//         buffer.commit(n);
+//
+//         while( !buffer.empty() )
+//         {
+//             HttpRequestParser::ParseResult res = buffer.parse(parser, req);
+//
+//             // Needs more input: back to prepare() and read(). With
+//             // setWaitForHead() nothing is consumed until the whole head
+//             // is there, so parsing again now would never get further.
+//             if( res == HttpRequestParser::ParsingIncompleted || parser.consumed() == 0 )
+//                 break;
+//             ...
+//         }
+//     }
+//
+// Memory is taken on the first prepare(), so idle connections cost
+// nothing. Unparsed bytes are only moved to the front when the free space
+// behind them is too small for a read, and the buffer only grows when
+// that is still not enough. Once a message that made it grow is consumed,
+// it goes back to its initial capacity.
+class ConnectionBuffer
+{
+public:
+    struct Limits
+    {
+        Limits()
+            : initialCapacity(4096), maxCapacity(1024 * 1024), minRead(1024)
+        {}
+
+        size_t initialCapacity;  // allocated by the first prepare(), kept when shrinking
+        size_t maxCapacity;      // never grown beyond
+        size_t minRead;          // free space below which prepare() compacts or grows
+    };
+
+    explicit ConnectionBuffer(const Limits &limits = Limits())
+        : limits(limits), head(0), tail(0)
+    {
+        if( this->limits.maxCapacity < this->limits.initialCapacity )
+            this->limits.maxCapacity = this->limits.initialCapacity;
+
+        if( this->limits.minRead > this->limits.maxCapacity )
+            this->limits.minRead = this->limits.maxCapacity;
+    }
+
+    // Make room for a read and return how much there is: at least minRead
+    // bytes unless the buffer is at maxCapacity, and 0 only if it is full
+    // of unparsed input.
+    size_t prepare()
+    {
+        if( storage.empty() )
+            storage.resize(limits.initialCapacity);
+
+        if( writable() >= limits.minRead )
+            return writable();
+
+        if( head > 0 )
+        {
+            memmove(&storage[0], &storage[head], tail - head);
+            tail -= head;
+            head = 0;
+
+            if( writable() >= limits.minRead )
+                return writable();
+        }
+
+        if( storage.size() < limits.maxCapacity )
+        {
+            size_t capacity = storage.size() * 2;
+
+            if( capacity < tail + limits.minRead )
+                capacity = tail + limits.minRead;
+
+            if( capacity > limits.maxCapacity )
+                capacity = limits.maxCapacity;
+
+            storage.resize(capacity);
+        }
+
+        return writable();
+    }
+
+    // Where to read to, and how much fits; valid until the next call that
+    // changes the buffer.
+    char *writeBegin()
+    {
+        return storage.empty() ? NULL : &storage[tail];
+    }
+
+    size_t writable() const
+    {
+        return storage.size() - tail;
+    }
+
+    // Account for `size` bytes read to writeBegin().
+    void commit(size_t size)
+    {
+        tail += size;
+    }
+
+    // The bytes received and not consumed yet.
+    const char *begin() const
+    {
+        return storage.empty() ? NULL : &storage[head];
+    }
+
+    const char *end() const
+    {
+        return begin() + size();
+    }
+
+    size_t size() const
+    {
+        return tail - head;
+    }
+
+    bool empty() const
+    {
+        return head == tail;
+    }
+
+    // Drop `size` bytes from the front, e.g. the parser's consumed().
+    void consume(size_t size)
+    {
+        head += size;
+
+        if( head == tail )
+            clear();
+    }
+
+    // Drop everything, e.g. before closing the connection.
+    void clear()
+    {
+        head = 0;
+        tail = 0;
+
+        if( storage.size() > limits.initialCapacity )
+            std::vector<char>(limits.initialCapacity).swap(storage);
+    }
+
+    // Parse the buffered bytes and consume what the parser used.
+    template<typename Parser, typename Message>
+    typename Parser::ParseResult parse(Parser &parser, Message &msg)
+    {
+        typename Parser::ParseResult result = parser.parse(msg, begin(), end());
+        consume(parser.consumed());
+        return result;
+    }
+
+    size_t capacity() const
+    {
+        return storage.size();
+    }
+
+private:
+    ConnectionBuffer(const ConnectionBuffer &);
+    ConnectionBuffer &operator=(const ConnectionBuffer &);
+
+    Limits limits;
+    std::vector<char> storage;
+    size_t head;  // first byte not consumed
+    size_t tail;  // end of the received bytes
+};
+
+} // namespace httpparser
+
+#endif // HTTPPARSER_CONNECTIONBUFFER_H
@@ -0,0 +1,361 @@
+/*
+ * Copyright (C) Alex Nekipelov (alex@nekipelov.net)
+ * License: MIT
+ */
+
+#ifndef HTTPPARSER_COROUTINEREADER_H
+#define HTTPPARSER_COROUTINEREADER_H
+
+#if !defined(__cpp_impl_coroutine)
+#error "httpparser/coroutinereader.h needs C++20 coroutines"
+#endif
+
+#include <httpparser/request.h>
+#include <httpparser/response.h>
+#include <httpparser/httprequestparser.h>
+#include <httpparser/httpresponseparser.h>
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+
+#include <string.h>
+
+namespace httpparser
+{
+
+// Memory for one coroutine frame at a time. A reader awaits one message
+// at a time, so its frames reuse the same block instead of the heap; a
+// frame that does not fit, or one started while another is alive, falls
+// back to operator new.
+class FrameArena
+{
+public:
+    FrameArena() : inUse(false), heapFrames(0)
+    {
+    }
+
+    void *allocate(size_t size)
+    {
+        if( !inUse && size <= sizeof(storage) )
+        {
+            inUse = true;
+            return storage;
+        }
+
+        ++heapFrames;
+        return ::operator new(size);
+    }
+
+    void deallocate(void *p)
+    {
+        if( p == storage )
+            inUse = false;
+        else
+            ::operator delete(p);
+    }
+
+    // Number of frames that went to the heap so far.
+    size_t heapAllocations() const
+    {
+        return heapFrames;
+    }
+
+private:
+    FrameArena(const FrameArena &);
+    FrameArena &operator=(const FrameArena &);
+
+    enum {
+        capacity = 512
+    };
+
+    alignas(std::max_align_t) char storage[capacity];
+    bool inUse;
+    size_t heapFrames;
+};
+
+namespace detail
+{
+
+// Lazily started coroutine returning T. Awaiting it runs the body; if the
+// body finishes without suspending, the awaiting coroutine goes on without
+// being suspended at all, otherwise it is resumed when the body returns.
+// (Symmetric transfer would be simpler, but GCC does not make it a tail
+// call at -O0 and the stack then still holds the finished coroutine.) The
+// frame comes from the FrameArena of the object the coroutine is a member
+// of.
+template <typename T>
+class ArenaTask
+{
+public:
+    struct promise_type
+    {
+        promise_type() : runningInline(false)
+        {
+        }
+
+        ArenaTask get_return_object()
+        {
+            return ArenaTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return std::suspend_always();
+        }
+
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept
+            {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<promise_type> h) noexcept
+            {
+                if( !h.promise().runningInline )
+                    h.promise().continuation.resume();
+            }
+
+            void await_resume() noexcept
+            {
+            }
+        };
+
+        FinalAwaiter final_suspend() noexcept
+        {
+            return FinalAwaiter();
+        }
+
+        void return_value(T v)
+        {
+            value = v;
+        }
+
+        void unhandled_exception()
+        {
+            exception = std::current_exception();
+        }
+
+        // The arena pointer is stored in a header in front of the frame,
+        // where operator delete can find it again.
+        template <typename Owner, typename... Args>
+        static void *operator new(size_t size, Owner &owner, Args &...)
+        {
+            FrameArena *arena = &owner.frameArena();
+            char *block = static_cast<char *>(arena->allocate(headerSize + size));
+            memcpy(block, &arena, sizeof(arena));
+            return block + headerSize;
+        }
+
+        static void operator delete(void *frame)
+        {
+            char *block = static_cast<char *>(frame) - headerSize;
+            FrameArena *arena;
+            memcpy(&arena, block, sizeof(arena));
+            arena->deallocate(block);
+        }
+
+        enum {
+            headerSize = alignof(std::max_align_t)
+        };
+
+        T value;
+        std::exception_ptr exception;
+        std::coroutine_handle<> continuation;
+        bool runningInline;
+    };
+
+    ArenaTask(ArenaTask &&other) noexcept : handle(other.handle)
+    {
+        other.handle = nullptr;
+    }
+
+    ~ArenaTask()
+    {
+        if( handle )
+            handle.destroy();
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> awaiting)
+    {
+        handle.promise().continuation = awaiting;
+        handle.promise().runningInline = true;
+        handle.resume();
+
+        if( handle.done() )
+            return false;
+
+        handle.promise().runningInline = false;
+        return true;
+    }
+
+    T await_resume()
+    {
+        if( handle.promise().exception )
+            std::rethrow_exception(handle.promise().exception);
+
+        return handle.promise().value;
+    }
+
+private:
+    explicit ArenaTask(std::coroutine_handle<promise_type> h) : handle(h)
+    {
+    }
+
+    ArenaTask(const ArenaTask &);
+    ArenaTask &operator=(const ArenaTask &);
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+} // namespace detail
+
+// GCC 11 and later pair the frame's operator delete with the placement
+// operator new above by signature and warn about a mismatch that is not
+// there.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+// Reads messages one after another from an asynchronous byte source:
+//
+//     RequestReader<Socket> reader(socket);
+//     Request req;
+//
+//     for(;;)
+//     {
+//         HttpRequestParser::ParseResult res = co_await reader.next_request(req);
+//
+//         if( res != HttpRequestParser::ParsingCompleted )
+//             break;
+//         ...
+//     }
+//
+// (GCC 12 miscompiles a co_await in a loop condition that resumes later,
+// hence the loop above.)
+//
+// `Source` needs one member: `co_await source.read_some(char *data,
+// size_t size)` yields the number of bytes read, 0 at the end of the
+// stream. Received bytes go into a fixed buffer inside the reader; bytes
+// after a completed message stay there for the next call. Frames of the
+// reader's coroutines live in its FrameArena, so a read costs no heap
+// allocation beyond what the message itself needs.
+template <typename Source, typename Parser, typename Message, size_t BufferSize = 16 * 1024>
+class MessageReader
+{
+public:
+    typedef typename Parser::ParseResult ParseResult;
+
+    explicit MessageReader(Source &source)
+        : source(source), begin(0), end(0)
+    {
+    }
+
+    // Read the next message into `msg`, cleared first. Yields
+    // ParsingCompleted, ParsingError for a malformed message, or
+    // ParsingIncompleted if the stream ends before a message does.
+    detail::ArenaTask<ParseResult> next(Message &msg)
+    {
+        msg.clear();
+        parser = Parser();
+
+        for(;;)
+        {
+            if( begin < end )
+            {
+                ParseResult res = parser.parse(msg, buffer + begin, buffer + end);
+                begin += parser.consumed();
+
+                if( res == Parser::ParsingCompleted || res == Parser::ParsingError )
+                    co_return res;
+            }
+
+            // The parser keeps its state between calls and normally uses
+            // every byte; whatever it left is moved to the front.
+            if( begin > 0 )
+            {
+                memmove(buffer, buffer + begin, end - begin);
+                end -= begin;
+                begin = 0;
+            }
+
+            if( end == BufferSize )
+                co_return Parser::ParsingError;
+
+            size_t n = co_await source.read_some(buffer + end, BufferSize - end);
+
+            if( n == 0 )
+                co_return Parser::ParsingIncompleted;
+
+            end += n;
+        }
+    }
+
+    // Bytes received but not parsed yet.
+    size_t buffered() const
+    {
+        return end - begin;
+    }
+
+    FrameArena &frameArena()
+    {
+        return frames;
+    }
+
+private:
+    MessageReader(const MessageReader &);
+    MessageReader &operator=(const MessageReader &);
+
+    Source &source;
+    Parser parser;
+    FrameArena frames;
+    size_t begin;
+    size_t end;
+    char buffer[BufferSize];
+};
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+template <typename Source, size_t BufferSize = 16 * 1024>
+class RequestReader : public MessageReader<Source, HttpRequestParser, Request, BufferSize>
+{
+public:
+    explicit RequestReader(Source &source)
+        : MessageReader<Source, HttpRequestParser, Request, BufferSize>(source)
+    {
+    }
+
+    detail::ArenaTask<HttpRequestParser::ParseResult> next_request(Request &req)
+    {
+        return this->next(req);
+    }
+};
+
+template <typename Source, size_t BufferSize = 16 * 1024>
+class ResponseReader : public MessageReader<Source, HttpResponseParser, Response, BufferSize>
+{
+public:
+    explicit ResponseReader(Source &source)
+        : MessageReader<Source, HttpResponseParser, Response, BufferSize>(source)
+    {
+    }
+
+    detail::ArenaTask<HttpResponseParser::ParseResult> next_response(Response &resp)
+    {
+        return this->next(resp);
+    }
+};
+
+} // namespace httpparser
+
+#endif // HTTPPARSER_COROUTINEREADER_H
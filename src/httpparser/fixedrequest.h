@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) Alex Nekipelov (alex@nekipelov.net)
+ * License: MIT
+ */
+
+#ifndef HTTPPARSER_FIXEDREQUEST_H
+#define HTTPPARSER_FIXEDREQUEST_H
+
+#include <string>
+
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+
+namespace httpparser
+{
+
+// Text inside a FixedRequest. Not null-terminated; valid while the request
+// is alive and unchanged.
+struct StringView
+{
+    StringView() : data(NULL), size(0)
+    {}
+
+    StringView(const char *data, size_t size) : data(data), size(size)
+    {}
+
+    const char *data;
+    size_t size;
+
+    bool empty() const
+    {
+        return size == 0;
+    }
+
+    bool operator==(const char *str) const
+    {
+        return strlen(str) == size && memcmp(data, str, size) == 0;
+    }
+
+    bool operator!=(const char *str) const
+    {
+        return !(*this == str);
+    }
+
+    // Case-insensitive comparison, as header names need.
+    bool equalsIgnoreCase(const char *str) const
+    {
+        return strlen(str) == size && strncasecmp(data, str, size) == 0;
+    }
+
+    std::string str() const
+    {
+        return std::string(data, size);
+    }
+};
+
+// Request head kept entirely in inline storage: the raw head is copied into
+// `head` and the method, target and headers are ranges inside it. Filled by
+// FixedRequestParser, which never allocates and reports
+// ParsingLimitExceeded when a head needs more than MaxHeadBytes bytes or
+// more than MaxHeaders headers. The body is not stored; see
+// FixedRequestParser.
+template<size_t MaxHeaders, size_t MaxHeadBytes>
+struct FixedRequest
+{
+    FixedRequest()
+        : headSize(0), versionMajor(0), versionMinor(0), keepAlive(false), headerCount(0)
+    {}
+
+    enum {
+        maxHeaders = MaxHeaders,
+        maxHeadBytes = MaxHeadBytes
+    };
+
+    struct Range
+    {
+        Range() : offset(0), length(0)
+        {}
+
+        size_t offset;
+        size_t length;
+    };
+
+    struct HeaderItem
+    {
+        Range name;
+        Range value;
+    };
+
+    char head[MaxHeadBytes];
+    size_t headSize;
+
+    Range methodRange;
+    Range uriRange;
+    int versionMajor;
+    int versionMinor;
+    bool keepAlive;
+
+    HeaderItem headers[MaxHeaders];
+    size_t headerCount;
+
+    StringView method() const
+    {
+        return view(methodRange);
+    }
+
+    StringView uri() const
+    {
+        return view(uriRange);
+    }
+
+    StringView headerName(size_t i) const
+    {
+        return view(headers[i].name);
+    }
+
+    StringView headerValue(size_t i) const
+    {
+        return view(headers[i].value);
+    }
+
+    // Value of the first header called `name`, ignoring case; empty with a
+    // NULL `data` if there is none.
+    StringView header(const char *name) const
+    {
+        for(size_t i = 0; i < headerCount; ++i)
+        {
+            if( headerName(i).equalsIgnoreCase(name) )
+                return headerValue(i);
+        }
+
+        return StringView();
+    }
+
+    void clear()
+    {
+        headSize = 0;
+        methodRange = Range();
+        uriRange = Range();
+        versionMajor = 0;
+        versionMinor = 0;
+        keepAlive = false;
+        headerCount = 0;
+    }
+
+private:
+    StringView view(const Range &range) const
+    {
+        return StringView(head + range.offset, range.length);
+    }
+};
+
+} // namespace httpparser
+
+#endif // HTTPPARSER_FIXEDREQUEST_H
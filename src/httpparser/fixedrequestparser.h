@@ -0,0 +1,388 @@
+/*
+ * Copyright (C) Alex Nekipelov (alex@nekipelov.net)
+ * License: MIT
+ */
+
+#ifndef HTTPPARSER_FIXEDREQUESTPARSER_H
+#define HTTPPARSER_FIXEDREQUESTPARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fixedrequest.h"
+#include "inputsegment.h"
+
+namespace httpparser
+{
+
+// Parses a request head into a FixedRequest without touching the heap.
+//
+// parse() copies input into the request until the blank line after the
+// headers has arrived, then parses the head in place. It returns
+// ParsingCompleted if the request has no body and HeadersCompleted if one
+// follows; consumed() tells where the body (or the next request) starts.
+// The body is not stored: read contentLength() bytes, or decode a chunked
+// body in place with ChunkedDecoder.
+//
+// The accepted syntax and the rules for the request-target form,
+// Content-Length and Connection match HttpRequestParser, except that
+// HTTP/0.9 request lines and folded header lines are rejected.
+class FixedRequestParser
+{
+public:
+    FixedRequestParser()
+        : scanned(0), contentSize(0), chunked(false), expectsContinue(false), consumedSize(0)
+    {
+    }
+
+    enum ParseResult {
+        ParsingCompleted,
+        ParsingIncompleted,
+        ParsingError,
+        HeadersCompleted,
+        ParsingLimitExceeded
+    };
+
+    template<size_t MaxHeaders, size_t MaxHeadBytes>
+    ParseResult parse(FixedRequest<MaxHeaders, MaxHeadBytes> &req, const char *begin, const char *end)
+    {
+        size_t room = MaxHeadBytes - req.headSize;
+        size_t count = static_cast<size_t>(end - begin);
+
+        if( count > room )
+            count = room;
+
+        memcpy(req.head + req.headSize, begin, count);
+        req.headSize += count;
+
+        size_t headEnd = findHeadEnd(req.head, req.headSize);
+
+        if( headEnd == 0 )
+        {
+            consumedSize = count;
+
+            if( req.headSize == MaxHeadBytes )
+                return ParsingLimitExceeded;
+
+            return ParsingIncompleted;
+        }
+
+        // Bytes copied past the head belong to the body or the next request.
+        consumedSize = count - (req.headSize - headEnd);
+        req.headSize = headEnd;
+
+        ParseResult result = parseHead(req);
+
+        if( result != ParsingCompleted )
+            return result;
+
+        return chunked || contentSize != 0 ? HeadersCompleted : ParsingCompleted;
+    }
+
+    // Parse input scattered over `count` segments as if it were one range.
+    // consumed() then counts the bytes used over all segments.
+    template<size_t MaxHeaders, size_t MaxHeadBytes>
+    ParseResult parse(FixedRequest<MaxHeaders, MaxHeadBytes> &req, const InputSegment *segments, size_t count)
+    {
+        size_t total;
+        ParseResult result = detail::parseSegments(*this, req, segments, count, total);
+
+        consumedSize = total;
+        return result;
+    }
+
+    // Number of bytes of the last parse() input that were used.
+    size_t consumed() const
+    {
+        return consumedSize;
+    }
+
+    // Value of the Content-Length header, 0 if there is none.
+    size_t contentLength() const
+    {
+        return contentSize;
+    }
+
+    bool isChunked() const
+    {
+        return chunked;
+    }
+
+    // True if the client sent "Expect: 100-continue".
+    bool expectContinue() const
+    {
+        return expectsContinue;
+    }
+
+private:
+    // Size of the head up to and including its blank line, or 0 if it is
+    // not complete yet. Resumes after the bytes seen by the last call.
+    size_t findHeadEnd(const char *head, size_t size)
+    {
+        const char *p = head + scanned;
+        const char *end = head + size;
+
+        while( p != end )
+        {
+            p = static_cast<const char *>(memchr(p, '\n', end - p));
+
+            if( p == NULL )
+                break;
+
+            if( p - head >= 3 && p[-1] == '\r' && p[-2] == '\n' && p[-3] == '\r' )
+                return p + 1 - head;
+
+            ++p;
+        }
+
+        scanned = size;
+        return 0;
+    }
+
+    template<size_t MaxHeaders, size_t MaxHeadBytes>
+    ParseResult parseHead(FixedRequest<MaxHeaders, MaxHeadBytes> &req)
+    {
+        typedef typename FixedRequest<MaxHeaders, MaxHeadBytes>::HeaderItem HeaderItem;
+
+        const char *base = req.head;
+        const char *p = base;
+        const char *token = p;
+
+        // Method
+        while( *p != ' ' )
+        {
+            if( !isToken(*p) )
+                return ParsingError;
+            ++p;
+        }
+
+        if( p == token )
+            return ParsingError;
+
+        setRange(req.methodRange, base, token, p);
+
+        // Request-target
+        token = ++p;
+
+        if( isControl(*p) )
+            return ParsingError;
+
+        for(++p; *p != ' '; ++p)
+        {
+            if( isControl(*p) )
+                return ParsingError;
+        }
+
+        setRange(req.uriRange, base, token, p);
+
+        if( !isValidTarget(req.method(), token, p) )
+            return ParsingError;
+
+        // HTTP-version
+        ++p;
+
+        if( req.head + req.headSize - p < 5 || memcmp(p, "HTTP/", 5) != 0 )
+            return ParsingError;
+
+        p += 5;
+
+        if( !parseNumber(p, '.', req.versionMajor) ||
+            !parseNumber(p, '\r', req.versionMinor) || *p++ != '\n' )
+        {
+            return ParsingError;
+        }
+
+        bool post = req.method() == "POST" || req.method() == "PUT";
+
+        req.keepAlive = req.versionMajor > 1 || (req.versionMajor == 1 && req.versionMinor == 1);
+
+        // Only the first Connection header counts.
+        bool connectionSeen = false;
+
+        // Header fields
+        while( *p != '\r' )
+        {
+            if( req.headerCount == MaxHeaders )
+                return ParsingLimitExceeded;
+
+            HeaderItem &h = req.headers[req.headerCount++];
+
+            for(token = p; *p != ':'; ++p)
+            {
+                if( !isToken(*p) )
+                    return ParsingError;
+            }
+
+            if( p == token || p[1] != ' ' )
+                return ParsingError;
+
+            setRange(h.name, base, token, p);
+
+            for(token = p += 2; *p != '\r'; ++p)
+            {
+                if( isControl(*p) )
+                    return ParsingError;
+            }
+
+            if( p[1] != '\n' )
+                return ParsingError;
+
+            setRange(h.value, base, token, p);
+            p += 2;
+
+            StringView name = req.headerName(req.headerCount - 1);
+            StringView value = req.headerValue(req.headerCount - 1);
+
+            if( post && name.equalsIgnoreCase("Content-Length") )
+            {
+                if( !parseContentLength(value) )
+                    return ParsingError;
+            }
+            else if( post && name.equalsIgnoreCase("Transfer-Encoding") )
+            {
+                if( value.equalsIgnoreCase("chunked") )
+                    chunked = true;
+            }
+            else if( name.equalsIgnoreCase("Expect") )
+            {
+                if( value.equalsIgnoreCase("100-continue") )
+                    expectsContinue = true;
+            }
+            else if( name.equalsIgnoreCase("Connection") && !connectionSeen )
+            {
+                req.keepAlive = value.equalsIgnoreCase("Keep-Alive");
+                connectionSeen = true;
+            }
+        }
+
+        if( p + 2 != base + req.headSize )
+            return ParsingError;
+
+        return ParsingCompleted;
+    }
+
+    template<typename Range>
+    static void setRange(Range &range, const char *base, const char *begin, const char *end)
+    {
+        range.offset = begin - base;
+        range.length = end - begin;
+    }
+
+    // One of the four request-target forms (RFC 7230, section 5.3):
+    // "/path", "*", an authority with CONNECT, or an absolute url, which
+    // has to start with a scheme ending in ':'.
+    static bool isValidTarget(const StringView &method, const char *begin, const char *end)
+    {
+        if( *begin == '/' )
+            return true;
+        else if( *begin == '*' )
+            return end - begin == 1;
+        else if( method == "CONNECT" )
+            return true;
+        else if( !isAlpha(*begin) )
+            return false;
+
+        for(const char *p = begin + 1; p != end; ++p)
+        {
+            if( *p == ':' )
+                return true;
+            else if( !isAlpha(*p) && !isDigit(*p) && *p != '+' && *p != '-' && *p != '.' )
+                return false;
+        }
+
+        return false;
+    }
+
+    // Content-Length is one or more decimal digits, optionally surrounded
+    // by spaces or tabs, and has to fit in a size_t.
+    bool parseContentLength(const StringView &value)
+    {
+        const char *p = value.data;
+        const char *end = value.data + value.size;
+        size_t result = 0;
+
+        while( p != end && (*p == ' ' || *p == '\t') )
+            ++p;
+
+        if( p == end || !isDigit(*p) )
+            return false;
+
+        for(; p != end && isDigit(*p); ++p)
+        {
+            size_t digit = *p - '0';
+
+            if( result > (SIZE_MAX - digit) / 10 )
+                return false;
+
+            result = result * 10 + digit;
+        }
+
+        while( p != end && (*p == ' ' || *p == '\t') )
+            ++p;
+
+        if( p != end )
+            return false;
+
+        contentSize = result;
+        return true;
+    }
+
+    // Parse one or more digits followed by `terminator`.
+    static bool parseNumber(const char *&p, char terminator, int &value)
+    {
+        if( !isDigit(*p) )
+            return false;
+
+        for(value = 0; isDigit(*p); ++p)
+            value = value * 10 + *p - '0';
+
+        return *p++ == terminator;
+    }
+
+    // Check if a byte may appear in a method or header name.
+    static bool isToken(int c)
+    {
+        if( c < 0 || c > 127 || isControl(c) )
+            return false;
+
+        switch (c)
+        {
+        case '(': case ')': case '<': case '>': case '@':
+        case ',': case ';': case ':': case '\\': case '"':
+        case '/': case '[': case ']': case '?': case '=':
+        case '{': case '}': case ' ': case '\t':
+            return false;
+        default:
+            return true;
+        }
+    }
+
+    // Check if a byte is an HTTP control character.
+    static bool isControl(int c)
+    {
+        return (c >= 0 && c <= 31) || (c == 127);
+    }
+
+    // Check if a byte is an ASCII letter.
+    static bool isAlpha(int c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
+
+    // Check if a byte is a digit.
+    static bool isDigit(int c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    size_t scanned;
+    size_t contentSize;
+    bool chunked;
+    bool expectsContinue;
+    size_t consumedSize;
+};
+
+} // namespace httpparser
+
+#endif // HTTPPARSER_FIXEDREQUESTPARSER_H
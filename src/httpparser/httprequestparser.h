@@ -10,18 +10,61 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 #include "request.h"
+#include "messagelayout.h"
+#include "inputsegment.h"
+#include "parserdispatch.h"
 
 namespace httpparser
 {
 
+// States of the request parser, see parserdispatch.h.
+#define HTTPPARSER_REQUEST_STATES(X) \
+    X(RequestMethodStart) \
+    X(RequestMethod) \
+    X(RequestUriStart) \
+    X(RequestUri) \
+    X(RequestHttpVersion_h) \
+    X(RequestHttpVersion_ht) \
+    X(RequestHttpVersion_htt) \
+    X(RequestHttpVersion_http) \
+    X(RequestHttpVersion_slash) \
+    X(RequestHttpVersion_majorStart) \
+    X(RequestHttpVersion_major) \
+    X(RequestHttpVersion_minorStart) \
+    X(RequestHttpVersion_minor) \
+    X(RequestHttpVersion_newLine) \
+    X(HeaderLineStart) \
+    X(HeaderLws) \
+    X(HeaderName) \
+    X(SpaceBeforeHeaderValue) \
+    X(HeaderValue) \
+    X(ExpectingNewline_2) \
+    X(ExpectingNewline_3) \
+    X(Post) \
+    X(ChunkSize) \
+    X(ChunkExtensionName) \
+    X(ChunkExtensionValue) \
+    X(ChunkSizeNewLine) \
+    X(ChunkSizeNewLine_2) \
+    X(ChunkSizeNewLine_3) \
+    X(ChunkTrailerName) \
+    X(ChunkTrailerValue) \
+    X(ChunkDataNewLine_1) \
+    X(ChunkDataNewLine_2) \
+    X(ChunkData)
+
 class HttpRequestParser
 {
 public:
     HttpRequestParser()
-        : state(RequestMethodStart), contentSize(0),
-          chunkSize(0), chunked(false)
+        : state(RequestMethodStart), uriState(UriPath), uriStart(0),
+          contentSize(0), headerContentLength(0), chunkSize(0), chunked(false),
+          expectsContinue(false), stopAfterHeaders(false), discardBody(false),
+          waitForHead(false), headScanned(0), layout(NULL), inputBegin(NULL),
+          messageOffset(0), consumedSize(0)
 
     {
     }
@@ -29,12 +72,102 @@ public:
     enum ParseResult {
         ParsingCompleted,
         ParsingIncompleted,
-        ParsingError
+        ParsingError,
+        HeadersCompleted
     };
 
     ParseResult parse(Request &req, const char *begin, const char *end)
     {
-        return consume(req, begin, end);
+        const char *it = begin;
+        ParseResult result;
+
+        inputBegin = begin;
+
+        if( waitForHead && state == RequestMethodStart )
+            result = consumeHead(req, it, end);
+        else
+            result = consume(req, it, end);
+
+        consumedSize = it - begin;
+        messageOffset += consumedSize;
+
+        if( layout )
+            layout->size = messageOffset;
+
+        return result;
+    }
+
+    // Parse input scattered over `count` segments as if it were one range,
+    // tokens split between segments included, without copying it together.
+    // consumed() then counts the bytes used over all segments. With
+    // setWaitForHead() a head split between segments is not found; such a
+    // head has to be made contiguous first.
+    ParseResult parse(Request &req, const InputSegment *segments, size_t count)
+    {
+        size_t total;
+        ParseResult result = detail::parseSegments(*this, req, segments, count, total);
+
+        consumedSize = total;
+        return result;
+    }
+
+    // Number of bytes of the last parse() input that were used. Anything
+    // after them belongs to the next message (or, after HeadersCompleted,
+    // to the body) and must be passed to the next parse() call.
+    size_t consumed() const
+    {
+        return consumedSize;
+    }
+
+    // Return HeadersCompleted as soon as the blank line after the headers
+    // is seen if the message has a body. The framing accessors below are
+    // valid at that point and later parse() calls continue with the body.
+    void setStopAfterHeaders(bool stop)
+    {
+        stopAfterHeaders = stop;
+    }
+
+    // Frame the body as usual but do not store it in `content`. Useful to
+    // drain a rejected upload or a body nobody is interested in.
+    void setDiscardBody(bool discard)
+    {
+        discardBody = discard;
+    }
+
+    // Two-phase parsing: leave the message alone until its whole head has
+    // arrived, then parse the head in one pass. Until then parse() consumes
+    // nothing, so the caller passes the same bytes again followed by the
+    // newly received ones; the search for the end of the head resumes where
+    // it stopped. Pays off when heads usually arrive in one read.
+    void setWaitForHead(bool wait)
+    {
+        waitForHead = wait;
+    }
+
+    // Record where the start line, each header line and the body payload
+    // are in the raw input, e.g. to forward them verbatim from a proxy.
+    // The layout must be empty when the message starts; pass NULL to stop.
+    void setLayout(MessageLayout *messageLayout)
+    {
+        layout = messageLayout;
+    }
+
+    // Value of the Content-Length header, 0 if there is none.
+    size_t contentLength() const
+    {
+        return headerContentLength;
+    }
+
+    bool isChunked() const
+    {
+        return chunked;
+    }
+
+    // True if the client sent "Expect: 100-continue" and waits for an
+    // interim response before sending the body.
+    bool expectContinue() const
+    {
+        return expectsContinue;
     }
 
 private:
@@ -43,15 +176,37 @@ private:
         return strcasecmp(item.name.c_str(), "Connection") == 0;
     }
 
-    ParseResult consume(Request &req, const char *begin, const char *end)
+    ParseResult consume(Request &req, const char *&begin, const char *end)
     {
         while( begin != end )
         {
             char input = *begin++;
 
+            HTTPPARSER_DISPATCH(HTTPPARSER_REQUEST_STATES);
+
             switch (state)
             {
-            case RequestMethodStart:
+            HTTPPARSER_CASE(RequestMethodStart):
+                // Nearly every request starts with "GET " or "POST ": match
+                // them as words when enough input is at hand.
+                if( end - begin >= 4 )
+                {
+                    if( equal4(begin - 1, "GET ") )
+                    {
+                        req.method.assign("GET", 3);
+                        begin += 3;
+                        state = RequestUriStart;
+                        HTTPPARSER_NEXT;
+                    }
+                    else if( equal4(begin - 1, "POST") && begin[3] == ' ' )
+                    {
+                        req.method.assign("POST", 4);
+                        begin += 4;
+                        state = RequestUriStart;
+                        HTTPPARSER_NEXT;
+                    }
+                }
+
                 if( !isChar(input) || isControl(input) || isSpecial(input) )
                 {
                     return ParsingError;
@@ -61,8 +216,8 @@ private:
                     state = RequestMethod;
                     req.method.push_back(input);
                 }
-                break;
-            case RequestMethod:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(RequestMethod):
                 if( input == ' ' )
                 {
                     state = RequestUriStart;
@@ -75,8 +230,8 @@ private:
                 {
                     req.method.push_back(input);
                 }
-                break;
-            case RequestUriStart:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(RequestUriStart):
                 if( isControl(input) )
                 {
                     return ParsingError;
@@ -84,19 +239,29 @@ private:
                 else
                 {
                     state = RequestUri;
+                    startUri(req, input);
                     req.uri.push_back(input);
                 }
-                break;
-            case RequestUri:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(RequestUri):
                 if( input == ' ' )
                 {
+                    if( !finishUri(req) )
+                        return ParsingError;
+
                     state = RequestHttpVersion_h;
                 }
                 else if (input == '\r')
                 {
+                    if( !finishUri(req) )
+                        return ParsingError;
+
                     req.versionMajor = 0;
                     req.versionMinor = 9;
 
+                    if( layout )
+                        layout->startLine.length = offsetOf(begin);
+
                     return ParsingCompleted;
                 }
                 else if( isControl(input) )
@@ -105,10 +270,23 @@ private:
                 }
                 else
                 {
+                    scanUri(req, input, req.uri.size());
                     req.uri.push_back(input);
                 }
-                break;
-            case RequestHttpVersion_h:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(RequestHttpVersion_h):
+                // "HTTP/1.1\r" or "HTTP/1.0\r" in one step; the '\n' is
+                // left to the regular state.
+                if( end - begin >= 8 && begin[7] == '\r' &&
+                    (equal8(begin - 1, "HTTP/1.1") || equal8(begin - 1, "HTTP/1.0")) )
+                {
+                    req.versionMajor = 1;
+                    req.versionMinor = begin[6] - '0';
+                    begin += 8;
+                    state = RequestHttpVersion_newLine;
+                    HTTPPARSER_NEXT;
+                }
+
                 if( input == 'H' )
                 {
                     state = RequestHttpVersion_ht;
@@ -117,8 +295,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case RequestHttpVersion_ht:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(RequestHttpVersion_ht):
                 if( input == 'T' )
                 {
                     state = RequestHttpVersion_htt;
@@ -127,8 +305,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case RequestHttpVersion_htt:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(RequestHttpVersion_htt):
                 if( input == 'T' )
                 {
                     state = RequestHttpVersion_http;
@@ -137,8 +315,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case RequestHttpVersion_http:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(RequestHttpVersion_http):
                 if( input == 'P' )
                 {
                     state = RequestHttpVersion_slash;
@@ -147,8 +325,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case RequestHttpVersion_slash:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(RequestHttpVersion_slash):
                 if( input == '/' )
                 {
                     req.versionMajor = 0;
@@ -159,8 +337,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case RequestHttpVersion_majorStart:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(RequestHttpVersion_majorStart):
                 if( isDigit(input) )
                 {
                     req.versionMajor = input - '0';
@@ -170,8 +348,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case RequestHttpVersion_major:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(RequestHttpVersion_major):
                 if( input == '.' )
                 {
                     state = RequestHttpVersion_minorStart;
@@ -184,8 +362,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case RequestHttpVersion_minorStart:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(RequestHttpVersion_minorStart):
                 if( isDigit(input) )
                 {
                     req.versionMinor = input - '0';
@@ -195,11 +373,11 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case RequestHttpVersion_minor:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(RequestHttpVersion_minor):
                 if( input == '\r' )
                 {
-                    state = ResponseHttpVersion_newLine;
+                    state = RequestHttpVersion_newLine;
                 }
                 else if( isDigit(input) )
                 {
@@ -209,18 +387,21 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ResponseHttpVersion_newLine:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(RequestHttpVersion_newLine):
                 if( input == '\n' )
                 {
+                    if( layout )
+                        layout->startLine.length = offsetOf(begin);
+
                     state = HeaderLineStart;
                 }
                 else
                 {
                     return ParsingError;
                 }
-                break;
-            case HeaderLineStart:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(HeaderLineStart):
                 if( input == '\r' )
                 {
                     state = ExpectingNewline_3;
@@ -235,14 +416,17 @@ private:
                 }
                 else
                 {
-                    req.headers.push_back(Request::HeaderItem());
+                    if( layout )
+                        layout->headers.push_back(MessageLayout::Span(offsetOf(begin - 1), 0));
+
+                    addHeader(req);
                     req.headers.back().name.reserve(16);
                     req.headers.back().value.reserve(16);
                     req.headers.back().name.push_back(input);
                     state = HeaderName;
                 }
-                break;
-            case HeaderLws:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(HeaderLws):
                 if( input == '\r' )
                 {
                     state = ExpectingNewline_2;
@@ -259,8 +443,8 @@ private:
                     state = HeaderValue;
                     req.headers.back().value.push_back(input);
                 }
-                break;
-            case HeaderName:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(HeaderName):
                 if( input == ':' )
                 {
                     state = SpaceBeforeHeaderValue;
@@ -273,8 +457,8 @@ private:
                 {
                     req.headers.back().name.push_back(input);
                 }
-                break;
-            case SpaceBeforeHeaderValue:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(SpaceBeforeHeaderValue):
                 if( input == ' ' )
                 {
                     state = HeaderValue;
@@ -283,25 +467,13 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case HeaderValue:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(HeaderValue):
                 if( input == '\r' )
                 {
-                    if( req.method == "POST" || req.method == "PUT" )
-                    {
-                        Request::HeaderItem &h = req.headers.back();
-
-                        if( strcasecmp(h.name.c_str(), "Content-Length") == 0 )
-                        {
-                            contentSize = atoi(h.value.c_str());
-                            req.content.reserve( contentSize );
-                        }
-                        else if( strcasecmp(h.name.c_str(), "Transfer-Encoding") == 0 )
-                        {
-                            if(strcasecmp(h.value.c_str(), "chunked") == 0)
-                                chunked = true;
-                        }
-                    }
+                    if( !checkHeader(req) )
+                        return ParsingError;
+
                     state = ExpectingNewline_2;
                 }
                 else if( isControl(input) )
@@ -312,69 +484,72 @@ private:
                 {
                     req.headers.back().value.push_back(input);
                 }
-                break;
-            case ExpectingNewline_2:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ExpectingNewline_2):
                 if( input == '\n' )
                 {
+                    if( layout )
+                        layout->headers.back().length = offsetOf(begin) - layout->headers.back().offset;
+
                     state = HeaderLineStart;
                 }
                 else
                 {
                     return ParsingError;
                 }
-                break;
-            case ExpectingNewline_3: {
-                std::vector<Request::HeaderItem>::iterator it = std::find_if(req.headers.begin(),
-                                                                    req.headers.end(),
-                                                                    checkIfConnection);
-
-                if( it != req.headers.end() )
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ExpectingNewline_3): {
+                if( input != '\n' )
                 {
-                    if( strcasecmp(it->value.c_str(), "Keep-Alive") == 0 )
-                    {
-                        req.keepAlive = true;
-                    }
-                    else  // == Close
-                    {
-                        req.keepAlive = false;
-                    }
-                }
-                else
-                {
-                    if( req.versionMajor > 1 || (req.versionMajor == 1 && req.versionMinor == 1) )
-                        req.keepAlive = true;
+                    return ParsingError;
                 }
 
-                if( chunked )
-                {
-                    state = ChunkSize;
-                }
-                else if( contentSize == 0 )
+                if( layout )
+                    layout->headSize = offsetOf(begin);
+
+                ParseResult result = finishHeaders(req);
+
+                if( result != ParsingIncompleted )
                 {
-                    if( input == '\n')
-                        return ParsingCompleted;
-                    else
-                        return ParsingError;
+                    return result;
                 }
-                else
+                HTTPPARSER_NEXT;
+            }
+            HTTPPARSER_CASE(Post): {
+                // `input` is the first body byte in this buffer; take the
+                // rest of the body that is available in one step.
+                size_t count = std::min(contentSize - 1, static_cast<size_t>(end - begin));
+
+                if( !discardBody )
                 {
-                    state = Post;
+                    // Reserved only now that the body arrives: a caller that
+                    // stops after the headers may still reject the length.
+                    if( req.content.empty() )
+                        req.content.reserve(headerContentLength);
+
+                    req.content.push_back(input);
+                    req.content.insert(req.content.end(), begin, begin + count);
                 }
-                break;
-            }
-            case Post:
-                --contentSize;
-                req.content.push_back( input );
+
+                if( layout )
+                    layout->addBody(offsetOf(begin - 1), count + 1);
+
+                begin += count;
+                contentSize -= count + 1;
 
                 if( contentSize == 0 )
                 {
                     return ParsingCompleted;
                 }
-                break;
-            case ChunkSize:
-                if( isalnum(input) )
+                HTTPPARSER_NEXT;
+            }
+            HTTPPARSER_CASE(ChunkSize):
+                if( isHexDigit(input) )
                 {
-                    chunkSizeStr.push_back(input);
+                    if( chunkSize > (SIZE_MAX >> 4) )
+                        return ParsingError;
+
+                    chunkSize = chunkSize * 16 + hexValue(input);
                 }
                 else if( input == ';' )
                 {
@@ -388,8 +563,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ChunkExtensionName:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ChunkExtensionName):
                 if( isalnum(input) || input == ' ' )
                 {
                     // skip
@@ -406,8 +581,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ChunkExtensionValue:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ChunkExtensionValue):
                 if( isalnum(input) || input == ' ' )
                 {
                     // skip
@@ -420,13 +595,12 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ChunkSizeNewLine:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ChunkSizeNewLine):
                 if( input == '\n' )
                 {
-                    chunkSize = strtol(chunkSizeStr.c_str(), NULL, 16);
-                    chunkSizeStr.clear();
-                    req.content.reserve(req.content.size() + chunkSize);
+                    if( !discardBody )
+                        req.content.reserve(req.content.size() + chunkSize);
 
                     if( chunkSize == 0 )
                         state = ChunkSizeNewLine_2;
@@ -437,13 +611,13 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ChunkSizeNewLine_2:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ChunkSizeNewLine_2):
                 if( input == '\r' )
                 {
                     state = ChunkSizeNewLine_3;
                 }
-                else if( isalpha(input) )
+                else if( isChar(input) && !isControl(input) && !isSpecial(input) )
                 {
                     state = ChunkTrailerName;
                 }
@@ -451,8 +625,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ChunkSizeNewLine_3:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ChunkSizeNewLine_3):
                 if( input == '\n' )
                 {
                     return ParsingCompleted;
@@ -461,9 +635,9 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ChunkTrailerName:
-                if( isalnum(input) )
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ChunkTrailerName):
+                if( isChar(input) && !isControl(input) && !isSpecial(input) )
                 {
                     // skip
                 }
@@ -475,30 +649,43 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ChunkTrailerValue:
-                if( isalnum(input) || input == ' ' )
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ChunkTrailerValue):
+                if( input == '\r' )
                 {
-                    // skip
+                    state = ChunkSizeNewLine;
                 }
-                else if( input == '\r' )
+                else if( !isControl(input) || input == '\t' )
                 {
-                    state = ChunkSizeNewLine;
+                    // skip
                 }
                 else
                 {
                     return ParsingError;
                 }
-                break;
-            case ChunkData:
-                req.content.push_back(input);
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ChunkData): {
+                size_t count = std::min(chunkSize - 1, static_cast<size_t>(end - begin));
 
-                if( --chunkSize == 0 )
+                if( !discardBody )
+                {
+                    req.content.push_back(input);
+                    req.content.insert(req.content.end(), begin, begin + count);
+                }
+
+                if( layout )
+                    layout->addBody(offsetOf(begin - 1), count + 1);
+
+                begin += count;
+                chunkSize -= count + 1;
+
+                if( chunkSize == 0 )
                 {
                     state = ChunkDataNewLine_1;
                 }
-                break;
-            case ChunkDataNewLine_1:
+                HTTPPARSER_NEXT;
+            }
+            HTTPPARSER_CASE(ChunkDataNewLine_1):
                 if( input == '\r' )
                 {
                     state = ChunkDataNewLine_2;
@@ -507,8 +694,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ChunkDataNewLine_2:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ChunkDataNewLine_2):
                 if( input == '\n' )
                 {
                     state = ChunkSize;
@@ -517,7 +704,7 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
+                HTTPPARSER_NEXT;
             default:
                 return ParsingError;
             }
@@ -526,6 +713,520 @@ private:
         return ParsingIncompleted;
     }
 
+    // Append an empty header, taking the strings of one kept by
+    // Request::reset() if there is any, so that their memory is reused.
+    static void addHeader(Request &req)
+    {
+        req.headers.push_back(Request::HeaderItem());
+
+        if( !req.spareHeaders.empty() )
+        {
+            req.headers.back().name.swap(req.spareHeaders.back().name);
+            req.headers.back().value.swap(req.spareHeaders.back().value);
+            req.spareHeaders.pop_back();
+        }
+    }
+
+    // Pick up framing information from the last header. Returns false if
+    // it is malformed.
+    bool checkHeader(Request &req)
+    {
+        Request::HeaderItem &h = req.headers.back();
+
+        if( req.method == "POST" || req.method == "PUT" )
+        {
+            if( strcasecmp(h.name.c_str(), "Content-Length") == 0 )
+            {
+                if( !parseContentLength(h.value, contentSize) )
+                    return false;
+
+                headerContentLength = contentSize;
+            }
+            else if( strcasecmp(h.name.c_str(), "Transfer-Encoding") == 0 )
+            {
+                if(strcasecmp(h.value.c_str(), "chunked") == 0)
+                    chunked = true;
+            }
+        }
+
+        if( strcasecmp(h.name.c_str(), "Expect") == 0 &&
+            strcasecmp(h.value.c_str(), "100-continue") == 0 )
+        {
+            expectsContinue = true;
+        }
+
+        return true;
+    }
+
+    // Content-Length is one or more decimal digits, optionally surrounded
+    // by spaces or tabs. Anything else, or a value that does not fit in a
+    // size_t, is an error rather than a guess.
+    static bool parseContentLength(const std::string &value, size_t &length)
+    {
+        std::string::const_iterator it = value.begin();
+        length = 0;
+
+        while( it != value.end() && (*it == ' ' || *it == '\t') )
+            ++it;
+
+        if( it == value.end() || *it < '0' || *it > '9' )
+            return false;
+
+        for(; it != value.end() && *it >= '0' && *it <= '9'; ++it)
+        {
+            size_t digit = *it - '0';
+
+            if( length > (SIZE_MAX - digit) / 10 )
+                return false;
+
+            length = length * 10 + digit;
+        }
+
+        while( it != value.end() && (*it == ' ' || *it == '\t') )
+            ++it;
+
+        return it == value.end();
+    }
+
+    // Called after the blank line that ends the head. Returns
+    // ParsingIncompleted if a body follows.
+    ParseResult finishHeaders(Request &req)
+    {
+        std::vector<Request::HeaderItem>::iterator it = std::find_if(req.headers.begin(),
+                                                            req.headers.end(),
+                                                            checkIfConnection);
+
+        if( it != req.headers.end() )
+        {
+            if( strcasecmp(it->value.c_str(), "Keep-Alive") == 0 )
+            {
+                req.keepAlive = true;
+            }
+            else  // == Close
+            {
+                req.keepAlive = false;
+            }
+        }
+        else
+        {
+            if( req.versionMajor > 1 || (req.versionMajor == 1 && req.versionMinor == 1) )
+                req.keepAlive = true;
+        }
+
+        if( chunked )
+        {
+            state = ChunkSize;
+        }
+        else if( contentSize == 0 )
+        {
+            return ParsingCompleted;
+        }
+        else
+        {
+            state = Post;
+        }
+
+        if( stopAfterHeaders )
+        {
+            return HeadersCompleted;
+        }
+
+        return ParsingIncompleted;
+    }
+
+    // First phase of setWaitForHead() mode: find the end of the head, then
+    // parse all of it at once and continue with the body, if any.
+    ParseResult consumeHead(Request &req, const char *&begin, const char *end)
+    {
+        const char *headEnd = findHeadEnd(begin, end);
+
+        if( headEnd == NULL )
+        {
+            // An HTTP/0.9 request is a single line without a blank line.
+            const char *lineEnd = static_cast<const char *>(memchr(begin, '\n', end - begin));
+
+            if( lineEnd && isHttp09RequestLine(begin, lineEnd) )
+                return consume(req, begin, end);
+
+            return ParsingIncompleted;
+        }
+
+        headScanned = 0;
+
+        const char *it = begin;
+        ParseResult result = parseHead(req, it, headEnd);
+
+        if( result == ParsingIncompleted )
+        {
+            // Folded header lines and HTTP/0.9 are left to the state machine.
+            clearHead(req);
+            return consume(req, begin, end);
+        }
+        else if( result == ParsingError )
+        {
+            return result;
+        }
+
+        begin = headEnd;
+        result = finishHeaders(req);
+
+        if( result != ParsingIncompleted )
+            return result;
+
+        return consume(req, begin, end);
+    }
+
+    // Find the byte after the blank line that ends the head, or return NULL
+    // and remember how far the search went. memchr() is vectorized by the C
+    // library, so whole header lines are skipped at once.
+    const char *findHeadEnd(const char *begin, const char *end)
+    {
+        const char *p = begin + headScanned;
+
+        while( p != end )
+        {
+            p = static_cast<const char *>(memchr(p, '\n', end - p));
+
+            if( p == NULL )
+                break;
+
+            if( p - begin >= 3 && p[-1] == '\r' && p[-2] == '\n' && p[-3] == '\r' )
+                return p + 1;
+
+            ++p;
+        }
+
+        // The check above looks back from each '\n', so a blank line split
+        // across calls is still found.
+        headScanned = end - begin;
+        return NULL;
+    }
+
+    static bool isHttp09RequestLine(const char *begin, const char *lineEnd)
+    {
+        const char *space = static_cast<const char *>(memchr(begin, ' ', lineEnd - begin));
+        return space && memchr(space + 1, ' ', lineEnd - space - 1) == NULL;
+    }
+
+    // Parse the complete head [begin, headEnd) straight from the buffer.
+    // Accepts and rejects exactly what the state machine does, except that
+    // input it does not handle (folded header lines, HTTP/0.9) yields
+    // ParsingIncompleted.
+    ParseResult parseHead(Request &req, const char *&begin, const char *headEnd)
+    {
+        const char *p = begin;
+        const char *token = p;
+
+        // Method
+        while( *p != ' ' )
+        {
+            if( !isToken(*p) )
+                return ParsingError;
+            ++p;
+        }
+
+        if( p == token )
+            return ParsingError;
+
+        req.method.assign(token, p);
+        token = ++p;
+
+        // Request-target
+        if( isControl(*p) )
+            return ParsingError;
+
+        startUri(req, *p++);
+
+        for(; *p != ' '; ++p)
+        {
+            if( *p == '\r' )
+                return ParsingIncompleted;
+            else if( isControl(*p) )
+                return ParsingError;
+
+            scanUri(req, *p, p - token);
+        }
+
+        req.uri.assign(token, p);
+
+        if( !finishUri(req) )
+            return ParsingError;
+
+        ++p;
+
+        // HTTP-version
+        if( headEnd - p < 5 || memcmp(p, "HTTP/", 5) != 0 )
+            return ParsingError;
+
+        p += 5;
+
+        if( !parseVersionNumber(p, '.', req.versionMajor) ||
+            !parseVersionNumber(p, '\r', req.versionMinor) || *p++ != '\n' )
+        {
+            return ParsingError;
+        }
+
+        if( layout )
+            layout->startLine.length = offsetOf(p);
+
+        // Header fields
+        while( *p != '\r' )
+        {
+            if( *p == ' ' || *p == '\t' )
+                return ParsingIncompleted;
+
+            const char *line = p;
+
+            for(token = p; *p != ':'; ++p)
+            {
+                if( !isToken(*p) )
+                    return ParsingError;
+            }
+
+            if( p == token || p[1] != ' ' )
+                return ParsingError;
+
+            addHeader(req);
+            req.headers.back().name.assign(token, p);
+
+            for(token = p += 2; *p != '\r'; ++p)
+            {
+                if( isControl(*p) )
+                    return ParsingError;
+            }
+
+            if( p[1] != '\n' )
+                return ParsingError;
+
+            req.headers.back().value.assign(token, p);
+            p += 2;
+
+            if( !checkHeader(req) )
+                return ParsingError;
+
+            if( layout )
+                layout->headers.push_back(MessageLayout::Span(offsetOf(line), p - line));
+        }
+
+        if( p + 2 != headEnd )
+            return ParsingError;
+
+        if( layout )
+            layout->headSize = offsetOf(headEnd);
+
+        return ParsingCompleted;
+    }
+
+    // Parse one or more digits followed by `terminator`.
+    bool parseVersionNumber(const char *&p, char terminator, int &value)
+    {
+        if( !isDigit(*p) )
+            return false;
+
+        for(value = 0; isDigit(*p); ++p)
+            value = value * 10 + *p - '0';
+
+        return *p++ == terminator;
+    }
+
+    // Undo a partial parseHead() before the state machine starts over.
+    void clearHead(Request &req)
+    {
+        req.method.clear();
+        req.uri.clear();
+        req.uriAuthority = Request::UriRange();
+        req.uriPath = Request::UriRange();
+        req.uriQuery = Request::UriRange();
+        req.uriFragment = Request::UriRange();
+        req.headers.clear();
+
+        contentSize = 0;
+        headerContentLength = 0;
+        chunked = false;
+        expectsContinue = false;
+
+        if( layout )
+            layout->clear();
+    }
+
+    // Classify the request-target by its first byte.
+    void startUri(Request &req, char input)
+    {
+        uriStart = 0;
+
+        if( input == '/' )
+        {
+            req.uriForm = Request::OriginForm;
+            uriState = UriPath;
+        }
+        else if( input == '*' )
+        {
+            req.uriForm = Request::AsteriskForm;
+            uriState = UriNone;
+        }
+        else if( req.method == "CONNECT" )
+        {
+            req.uriForm = Request::AuthorityForm;
+            uriState = UriAuthority;
+        }
+        else if( isAlpha(input) )
+        {
+            // Absolute-form once the scheme ends with ':' (checked by
+            // finishUri()); anything else is not a valid target.
+            req.uriForm = Request::AbsoluteForm;
+            uriState = UriScheme;
+        }
+        else
+        {
+            uriState = UriInvalid;
+        }
+    }
+
+    // Track component boundaries of the request-target; `input` is the
+    // byte at offset `pos` of the target.
+    void scanUri(Request &req, char input, size_t pos)
+    {
+        switch( uriState )
+        {
+        case UriScheme:
+            if( input == ':' )
+                uriState = UriSchemeSlash1;
+            else if( !isAlpha(input) && !isDigit(input) && input != '+' && input != '-' && input != '.' )
+                uriState = UriInvalid;
+            break;
+        case UriSchemeSlash1:
+            if( input == '/' )
+            {
+                uriState = UriSchemeSlash2;
+            }
+            else
+            {
+                // "scheme:path" without an authority
+                uriStart = pos;
+                uriState = UriPath;
+                scanUri(req, input, pos);
+            }
+            break;
+        case UriSchemeSlash2:
+            if( input == '/' )
+            {
+                uriStart = pos + 1;
+                uriState = UriAuthority;
+            }
+            else
+            {
+                uriStart = pos - 1;
+                uriState = UriPath;
+                scanUri(req, input, pos);
+            }
+            break;
+        case UriAuthority:
+            if( input == '/' || input == '?' || input == '#' )
+            {
+                closeUriRange(req.uriAuthority, pos);
+                uriStart = pos;
+                uriState = UriPath;
+                scanUri(req, input, pos);
+            }
+            break;
+        case UriPath:
+            if( input == '?' )
+            {
+                closeUriRange(req.uriPath, pos);
+                uriStart = pos + 1;
+                uriState = UriQuery;
+            }
+            else if( input == '#' )
+            {
+                closeUriRange(req.uriPath, pos);
+                uriStart = pos + 1;
+                uriState = UriFragment;
+            }
+            break;
+        case UriQuery:
+            if( input == '#' )
+            {
+                closeUriRange(req.uriQuery, pos);
+                uriStart = pos + 1;
+                uriState = UriFragment;
+            }
+            break;
+        case UriFragment:
+        case UriNone:
+        case UriInvalid:
+            break;
+        }
+    }
+
+    bool finishUri(Request &req)
+    {
+        size_t pos = req.uri.size();
+
+        switch( uriState )
+        {
+        case UriScheme:
+        case UriInvalid:
+            return false;
+        case UriSchemeSlash1:
+        case UriSchemeSlash2:
+            break;
+        case UriAuthority:
+            closeUriRange(req.uriAuthority, pos);
+            break;
+        case UriPath:
+            closeUriRange(req.uriPath, pos);
+            break;
+        case UriQuery:
+            closeUriRange(req.uriQuery, pos);
+            break;
+        case UriFragment:
+            closeUriRange(req.uriFragment, pos);
+            break;
+        case UriNone:
+            return pos == 1;
+        }
+
+        return true;
+    }
+
+    void closeUriRange(Request::UriRange &range, size_t pos)
+    {
+        range.offset = uriStart;
+        range.length = pos - uriStart;
+    }
+
+    // Offset of `p`, a pointer into the current parse() input, from the
+    // beginning of the message.
+    size_t offsetOf(const char *p) const
+    {
+        return messageOffset + (p - inputBegin);
+    }
+
+    // Compare the 4 or 8 bytes at `p` with the start of `literal` as a
+    // single word. memcpy() keeps the loads unaligned-safe and compiles to
+    // one load; the literal side folds into a constant.
+    static inline bool equal4(const char *p, const char *literal)
+    {
+        uint32_t a, b;
+        memcpy(&a, p, 4);
+        memcpy(&b, literal, 4);
+        return a == b;
+    }
+
+    static inline bool equal8(const char *p, const char *literal)
+    {
+        uint64_t a, b;
+        memcpy(&a, p, 8);
+        memcpy(&b, literal, 8);
+        return a == b;
+    }
+
+    // Check if a byte may appear in a method or header name.
+    inline bool isToken(int c)
+    {
+        return isChar(c) && !isControl(c) && !isSpecial(c);
+    }
+
     // Check if a byte is an HTTP character.
     inline bool isChar(int c)
     {
@@ -553,71 +1254,68 @@ private:
         }
     }
 
+    // Check if a byte is an ASCII letter.
+    inline bool isAlpha(int c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
+
     // Check if a byte is a digit.
     inline bool isDigit(int c)
     {
         return c >= '0' && c <= '9';
     }
 
+    // Check if a byte is a hexadecimal digit.
+    inline bool isHexDigit(int c)
+    {
+        return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+    }
+
+    inline size_t hexValue(int c)
+    {
+        if( isDigit(c) )
+            return c - '0';
+        else if( c >= 'a' && c <= 'f' )
+            return c - 'a' + 10;
+        else
+            return c - 'A' + 10;
+    }
+
     // The current state of the parser.
     enum State
     {
-        RequestMethodStart,
-        RequestMethod,
-        RequestUriStart,
-        RequestUri,
-        RequestHttpVersion_h,
-        RequestHttpVersion_ht,
-        RequestHttpVersion_htt,
-        RequestHttpVersion_http,
-        RequestHttpVersion_slash,
-        RequestHttpVersion_majorStart,
-        RequestHttpVersion_major,
-        RequestHttpVersion_minorStart,
-        RequestHttpVersion_minor,
-
-        ResponseStatusStart,
-        ResponseHttpVersion_ht,
-        ResponseHttpVersion_htt,
-        ResponseHttpVersion_http,
-        ResponseHttpVersion_slash,
-        ResponseHttpVersion_majorStart,
-        ResponseHttpVersion_major,
-        ResponseHttpVersion_minorStart,
-        ResponseHttpVersion_minor,
-        ResponseHttpVersion_spaceAfterVersion,
-        ResponseHttpVersion_statusCodeStart,
-        ResponseHttpVersion_spaceAfterStatusCode,
-        ResponseHttpVersion_statusTextStart,
-        ResponseHttpVersion_newLine,
-
-        HeaderLineStart,
-        HeaderLws,
-        HeaderName,
-        SpaceBeforeHeaderValue,
-        HeaderValue,
-        ExpectingNewline_2,
-        ExpectingNewline_3,
-
-        Post,
-        ChunkSize,
-        ChunkExtensionName,
-        ChunkExtensionValue,
-        ChunkSizeNewLine,
-        ChunkSizeNewLine_2,
-        ChunkSizeNewLine_3,
-        ChunkTrailerName,
-        ChunkTrailerValue,
-
-        ChunkDataNewLine_1,
-        ChunkDataNewLine_2,
-        ChunkData,
+        HTTPPARSER_REQUEST_STATES(HTTPPARSER_STATE_ENUM)
     } state;
 
+    // The component of the request-target being scanned.
+    enum UriState
+    {
+        UriScheme,
+        UriSchemeSlash1,
+        UriSchemeSlash2,
+        UriAuthority,
+        UriPath,
+        UriQuery,
+        UriFragment,
+        UriNone,
+        UriInvalid  // neither of the four forms, e.g. a relative path
+    } uriState;
+
+    size_t uriStart;
     size_t contentSize;
-    std::string chunkSizeStr;
+    size_t headerContentLength;
     size_t chunkSize;
     bool chunked;
+    bool expectsContinue;
+    bool stopAfterHeaders;
+    bool discardBody;
+    bool waitForHead;
+    size_t headScanned;
+    MessageLayout *layout;
+    const char *inputBegin;
+    size_t messageOffset;
+    size_t consumedSize;
 };
 
 } // namespace httpparser
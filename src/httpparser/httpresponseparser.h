@@ -10,32 +10,164 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 #include "response.h"
+#include "messagelayout.h"
+#include "inputsegment.h"
+#include "parserdispatch.h"
 
 namespace httpparser
 {
 
+// States of the response parser, see parserdispatch.h.
+#define HTTPPARSER_RESPONSE_STATES(X) \
+    X(ResponseStatusStart) \
+    X(ResponseHttpVersion_ht) \
+    X(ResponseHttpVersion_htt) \
+    X(ResponseHttpVersion_http) \
+    X(ResponseHttpVersion_slash) \
+    X(ResponseHttpVersion_majorStart) \
+    X(ResponseHttpVersion_major) \
+    X(ResponseHttpVersion_minorStart) \
+    X(ResponseHttpVersion_minor) \
+    X(ResponseHttpVersion_statusCodeStart) \
+    X(ResponseHttpVersion_statusCode) \
+    X(ResponseHttpVersion_statusTextStart) \
+    X(ResponseHttpVersion_statusText) \
+    X(ResponseHttpVersion_newLine) \
+    X(HeaderLineStart) \
+    X(HeaderLws) \
+    X(HeaderName) \
+    X(SpaceBeforeHeaderValue) \
+    X(HeaderValue) \
+    X(ExpectingNewline_2) \
+    X(ExpectingNewline_3) \
+    X(Post) \
+    X(ChunkSize) \
+    X(ChunkExtensionName) \
+    X(ChunkExtensionValue) \
+    X(ChunkSizeNewLine) \
+    X(ChunkSizeNewLine_2) \
+    X(ChunkSizeNewLine_3) \
+    X(ChunkTrailerName) \
+    X(ChunkTrailerValue) \
+    X(ChunkDataNewLine_1) \
+    X(ChunkDataNewLine_2) \
+    X(ChunkData)
+
 class HttpResponseParser
 {
 public:
     HttpResponseParser()
         : state(ResponseStatusStart),
           contentSize(0),
+          headerContentLength(0),
           chunkSize(0),
-          chunked(false)
+          chunked(false),
+          stopAfterHeaders(false),
+          discardBody(false),
+          waitForHead(false),
+          headScanned(0),
+          layout(NULL),
+          inputBegin(NULL),
+          messageOffset(0),
+          consumedSize(0)
     {
     }
 
     enum ParseResult {
         ParsingCompleted,
         ParsingIncompleted,
-        ParsingError
+        ParsingError,
+        HeadersCompleted
     };
 
     ParseResult parse(Response &resp, const char *begin, const char *end)
     {
-        return consume(resp, begin, end);
+        const char *it = begin;
+        ParseResult result;
+
+        inputBegin = begin;
+
+        if( waitForHead && state == ResponseStatusStart )
+            result = consumeHead(resp, it, end);
+        else
+            result = consume(resp, it, end);
+
+        consumedSize = it - begin;
+        messageOffset += consumedSize;
+
+        if( layout )
+            layout->size = messageOffset;
+
+        return result;
+    }
+
+    // Parse input scattered over `count` segments as if it were one range,
+    // tokens split between segments included, without copying it together.
+    // consumed() then counts the bytes used over all segments. With
+    // setWaitForHead() a head split between segments is not found; such a
+    // head has to be made contiguous first.
+    ParseResult parse(Response &resp, const InputSegment *segments, size_t count)
+    {
+        size_t total;
+        ParseResult result = detail::parseSegments(*this, resp, segments, count, total);
+
+        consumedSize = total;
+        return result;
+    }
+
+    // Number of bytes of the last parse() input that were used. Anything
+    // after them belongs to the next message (or, after HeadersCompleted,
+    // to the body) and must be passed to the next parse() call.
+    size_t consumed() const
+    {
+        return consumedSize;
+    }
+
+    // Return HeadersCompleted as soon as the blank line after the headers
+    // is seen if the message has a body. The framing accessors below are
+    // valid at that point and later parse() calls continue with the body.
+    void setStopAfterHeaders(bool stop)
+    {
+        stopAfterHeaders = stop;
+    }
+
+    // Frame the body as usual but do not store it in `content`. Useful to
+    // drain a rejected upload or a body nobody is interested in.
+    void setDiscardBody(bool discard)
+    {
+        discardBody = discard;
+    }
+
+    // Two-phase parsing: leave the message alone until its whole head has
+    // arrived, then parse the head in one pass. Until then parse() consumes
+    // nothing, so the caller passes the same bytes again followed by the
+    // newly received ones; the search for the end of the head resumes where
+    // it stopped. Pays off when heads usually arrive in one read.
+    void setWaitForHead(bool wait)
+    {
+        waitForHead = wait;
+    }
+
+    // Record where the start line, each header line and the body payload
+    // are in the raw input, e.g. to forward them verbatim from a proxy.
+    // The layout must be empty when the message starts; pass NULL to stop.
+    void setLayout(MessageLayout *messageLayout)
+    {
+        layout = messageLayout;
+    }
+
+    // Value of the Content-Length header, 0 if there is none.
+    size_t contentLength() const
+    {
+        return headerContentLength;
+    }
+
+    bool isChunked() const
+    {
+        return chunked;
     }
 
 private:
@@ -44,15 +176,30 @@ private:
         return strcasecmp(item.name.c_str(), "Connection") == 0;
     }
 
-    ParseResult consume(Response &resp, const char *begin, const char *end)
+    ParseResult consume(Response &resp, const char *&begin, const char *end)
     {
         while( begin != end )
         {
             char input = *begin++;
 
+            HTTPPARSER_DISPATCH(HTTPPARSER_RESPONSE_STATES);
+
             switch (state)
             {
-            case ResponseStatusStart:
+            HTTPPARSER_CASE(ResponseStatusStart):
+                // "HTTP/1.1 " or "HTTP/1.0 " in one step when the whole
+                // prefix is at hand.
+                if( end - begin >= 8 && begin[7] == ' ' &&
+                    (equal8(begin - 1, "HTTP/1.1") || equal8(begin - 1, "HTTP/1.0")) )
+                {
+                    resp.versionMajor = 1;
+                    resp.versionMinor = begin[6] - '0';
+                    resp.statusCode = 0;
+                    begin += 8;
+                    state = ResponseHttpVersion_statusCodeStart;
+                    HTTPPARSER_NEXT;
+                }
+
                 if( input != 'H' )
                 {
                     return ParsingError;
@@ -61,8 +208,8 @@ private:
                 {
                     state = ResponseHttpVersion_ht;
                 }
-                break;
-            case ResponseHttpVersion_ht:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ResponseHttpVersion_ht):
                 if( input == 'T' )
                 {
                     state = ResponseHttpVersion_htt;
@@ -71,8 +218,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ResponseHttpVersion_htt:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ResponseHttpVersion_htt):
                 if( input == 'T' )
                 {
                     state = ResponseHttpVersion_http;
@@ -81,8 +228,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ResponseHttpVersion_http:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ResponseHttpVersion_http):
                 if( input == 'P' )
                 {
                     state = ResponseHttpVersion_slash;
@@ -91,8 +238,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ResponseHttpVersion_slash:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ResponseHttpVersion_slash):
                 if( input == '/' )
                 {
                     resp.versionMajor = 0;
@@ -103,8 +250,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ResponseHttpVersion_majorStart:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ResponseHttpVersion_majorStart):
                 if( isDigit(input) )
                 {
                     resp.versionMajor = input - '0';
@@ -114,8 +261,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ResponseHttpVersion_major:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ResponseHttpVersion_major):
                 if( input == '.' )
                 {
                     state = ResponseHttpVersion_minorStart;
@@ -128,8 +275,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ResponseHttpVersion_minorStart:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ResponseHttpVersion_minorStart):
                 if( isDigit(input) )
                 {
                     resp.versionMinor = input - '0';
@@ -139,8 +286,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ResponseHttpVersion_minor:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ResponseHttpVersion_minor):
                 if( input == ' ')
                 {
                     state = ResponseHttpVersion_statusCodeStart;
@@ -154,8 +301,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ResponseHttpVersion_statusCodeStart:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ResponseHttpVersion_statusCodeStart):
                 if( isDigit(input) )
                 {
                     resp.statusCode = input - '0';
@@ -165,8 +312,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ResponseHttpVersion_statusCode:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ResponseHttpVersion_statusCode):
                 if( isDigit(input) )
                 {
                     resp.statusCode = resp.statusCode * 10 + input - '0';
@@ -186,8 +333,8 @@ private:
                         return ParsingError;
                     }
                 }
-                break;
-            case ResponseHttpVersion_statusTextStart:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ResponseHttpVersion_statusTextStart):
                 if( isChar(input) )
                 {
                     resp.status += input;
@@ -197,8 +344,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ResponseHttpVersion_statusText:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ResponseHttpVersion_statusText):
                 if( input == '\r' )
                 {
                     state = ResponseHttpVersion_newLine;
@@ -211,18 +358,21 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ResponseHttpVersion_newLine:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ResponseHttpVersion_newLine):
                 if( input == '\n' )
                 {
+                    if( layout )
+                        layout->startLine.length = offsetOf(begin);
+
                     state = HeaderLineStart;
                 }
                 else
                 {
                     return ParsingError;
                 }
-                break;
-            case HeaderLineStart:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(HeaderLineStart):
                 if( input == '\r' )
                 {
                     state = ExpectingNewline_3;
@@ -237,14 +387,17 @@ private:
                 }
                 else
                 {
-                    resp.headers.push_back(Response::HeaderItem());
+                    if( layout )
+                        layout->headers.push_back(MessageLayout::Span(offsetOf(begin - 1), 0));
+
+                    addHeader(resp);
                     resp.headers.back().name.reserve(16);
                     resp.headers.back().value.reserve(16);
                     resp.headers.back().name.push_back(input);
                     state = HeaderName;
                 }
-                break;
-            case HeaderLws:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(HeaderLws):
                 if( input == '\r' )
                 {
                     state = ExpectingNewline_2;
@@ -261,8 +414,8 @@ private:
                     state = HeaderValue;
                     resp.headers.back().value.push_back(input);
                 }
-                break;
-            case HeaderName:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(HeaderName):
                 if( input == ':' )
                 {
                     state = SpaceBeforeHeaderValue;
@@ -275,8 +428,8 @@ private:
                 {
                     resp.headers.back().name.push_back(input);
                 }
-                break;
-            case SpaceBeforeHeaderValue:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(SpaceBeforeHeaderValue):
                 if( input == ' ' )
                 {
                     state = HeaderValue;
@@ -285,22 +438,13 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case HeaderValue:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(HeaderValue):
                 if( input == '\r' )
                 {
-                    Response::HeaderItem &h = resp.headers.back();
+                    if( !checkHeader(resp) )
+                        return ParsingError;
 
-                    if( strcasecmp(h.name.c_str(), "Content-Length") == 0 )
-                    {
-                        contentSize = atoi(h.value.c_str());
-                        resp.content.reserve( contentSize );
-                    }
-                    else if( strcasecmp(h.name.c_str(), "Transfer-Encoding") == 0 )
-                    {
-                        if(strcasecmp(h.value.c_str(), "chunked") == 0)
-                            chunked = true;
-                    }
                     state = ExpectingNewline_2;
                 }
                 else if( isControl(input) )
@@ -311,70 +455,72 @@ private:
                 {
                     resp.headers.back().value.push_back(input);
                 }
-                break;
-            case ExpectingNewline_2:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ExpectingNewline_2):
                 if( input == '\n' )
                 {
+                    if( layout )
+                        layout->headers.back().length = offsetOf(begin) - layout->headers.back().offset;
+
                     state = HeaderLineStart;
                 }
                 else
                 {
                     return ParsingError;
                 }
-                break;
-            case ExpectingNewline_3: {
-                std::vector<Response::HeaderItem>::iterator it = std::find_if(resp.headers.begin(),
-                                                                    resp.headers.end(),
-                                                                    checkIfConnection);
-
-                if( it != resp.headers.end() )
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ExpectingNewline_3): {
+                if( input != '\n' )
                 {
-                    if( strcasecmp(it->value.c_str(), "Keep-Alive") == 0 )
-                    {
-                        resp.keepAlive = true;
-                    }
-                    else  // == Close
-                    {
-                        resp.keepAlive = false;
-                    }
-                }
-                else
-                {
-                    if( resp.versionMajor > 1 || (resp.versionMajor == 1 && resp.versionMinor == 1) )
-                        resp.keepAlive = true;
+                    return ParsingError;
                 }
 
-                if( chunked )
-                {
-                    state = ChunkSize;
-                }
-                else if( contentSize == 0 )
+                if( layout )
+                    layout->headSize = offsetOf(begin);
+
+                ParseResult result = finishHeaders(resp);
+
+                if( result != ParsingIncompleted )
                 {
-                    if( input == '\n')
-                        return ParsingCompleted;
-                    else
-                        return ParsingError;
+                    return result;
                 }
+                HTTPPARSER_NEXT;
+            }
+            HTTPPARSER_CASE(Post): {
+                // `input` is the first body byte in this buffer; take the
+                // rest of the body that is available in one step.
+                size_t count = std::min(contentSize - 1, static_cast<size_t>(end - begin));
 
-                else
+                if( !discardBody )
                 {
-                    state = Post;
+                    // Reserved only now that the body arrives: a caller that
+                    // stops after the headers may still reject the length.
+                    if( resp.content.empty() )
+                        resp.content.reserve(headerContentLength);
+
+                    resp.content.push_back(input);
+                    resp.content.insert(resp.content.end(), begin, begin + count);
                 }
-                break;
-            }
-            case Post:
-                --contentSize;
-                resp.content.push_back(input);
+
+                if( layout )
+                    layout->addBody(offsetOf(begin - 1), count + 1);
+
+                begin += count;
+                contentSize -= count + 1;
 
                 if( contentSize == 0 )
                 {
                     return ParsingCompleted;
                 }
-                break;
-            case ChunkSize:
-                if( isalnum(input) )
+                HTTPPARSER_NEXT;
+            }
+            HTTPPARSER_CASE(ChunkSize):
+                if( isHexDigit(input) )
                 {
-                    chunkSizeStr.push_back(input);
+                    if( chunkSize > (SIZE_MAX >> 4) )
+                        return ParsingError;
+
+                    chunkSize = chunkSize * 16 + hexValue(input);
                 }
                 else if( input == ';' )
                 {
@@ -388,8 +534,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ChunkExtensionName:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ChunkExtensionName):
                 if( isalnum(input) || input == ' ' )
                 {
                     // skip
@@ -406,8 +552,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ChunkExtensionValue:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ChunkExtensionValue):
                 if( isalnum(input) || input == ' ' )
                 {
                     // skip
@@ -420,13 +566,12 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ChunkSizeNewLine:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ChunkSizeNewLine):
                 if( input == '\n' )
                 {
-                    chunkSize = strtol(chunkSizeStr.c_str(), NULL, 16);
-                    chunkSizeStr.clear();
-                    resp.content.reserve(resp.content.size() + chunkSize);
+                    if( !discardBody )
+                        resp.content.reserve(resp.content.size() + chunkSize);
 
                     if( chunkSize == 0 )
                         state = ChunkSizeNewLine_2;
@@ -437,13 +582,13 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ChunkSizeNewLine_2:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ChunkSizeNewLine_2):
                 if( input == '\r' )
                 {
                     state = ChunkSizeNewLine_3;
                 }
-                else if( isalpha(input) )
+                else if( isChar(input) && !isControl(input) && !isSpecial(input) )
                 {
                     state = ChunkTrailerName;
                 }
@@ -451,8 +596,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ChunkSizeNewLine_3:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ChunkSizeNewLine_3):
                 if( input == '\n' )
                 {
                     return ParsingCompleted;
@@ -461,9 +606,9 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ChunkTrailerName:
-                if( isalnum(input) )
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ChunkTrailerName):
+                if( isChar(input) && !isControl(input) && !isSpecial(input) )
                 {
                     // skip
                 }
@@ -475,30 +620,43 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ChunkTrailerValue:
-                if( isalnum(input) || input == ' ' )
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ChunkTrailerValue):
+                if( input == '\r' )
                 {
-                    // skip
+                    state = ChunkSizeNewLine;
                 }
-                else if( input == '\r' )
+                else if( !isControl(input) || input == '\t' )
                 {
-                    state = ChunkSizeNewLine;
+                    // skip
                 }
                 else
                 {
                     return ParsingError;
                 }
-                break;
-            case ChunkData:
-                resp.content.push_back(input);
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ChunkData): {
+                size_t count = std::min(chunkSize - 1, static_cast<size_t>(end - begin));
 
-                if( --chunkSize == 0 )
+                if( !discardBody )
+                {
+                    resp.content.push_back(input);
+                    resp.content.insert(resp.content.end(), begin, begin + count);
+                }
+
+                if( layout )
+                    layout->addBody(offsetOf(begin - 1), count + 1);
+
+                begin += count;
+                chunkSize -= count + 1;
+
+                if( chunkSize == 0 )
                 {
                     state = ChunkDataNewLine_1;
                 }
-                break;
-            case ChunkDataNewLine_1:
+                HTTPPARSER_NEXT;
+            }
+            HTTPPARSER_CASE(ChunkDataNewLine_1):
                 if( input == '\r' )
                 {
                     state = ChunkDataNewLine_2;
@@ -507,8 +665,8 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
-            case ChunkDataNewLine_2:
+                HTTPPARSER_NEXT;
+            HTTPPARSER_CASE(ChunkDataNewLine_2):
                 if( input == '\n' )
                 {
                     state = ChunkSize;
@@ -517,7 +675,7 @@ private:
                 {
                     return ParsingError;
                 }
-                break;
+                HTTPPARSER_NEXT;
             default:
                 return ParsingError;
             }
@@ -526,6 +684,322 @@ private:
         return ParsingIncompleted;
     }
 
+    // Append an empty header, taking the strings of one kept by
+    // Response::reset() if there is any, so that their memory is reused.
+    static void addHeader(Response &resp)
+    {
+        resp.headers.push_back(Response::HeaderItem());
+
+        if( !resp.spareHeaders.empty() )
+        {
+            resp.headers.back().name.swap(resp.spareHeaders.back().name);
+            resp.headers.back().value.swap(resp.spareHeaders.back().value);
+            resp.spareHeaders.pop_back();
+        }
+    }
+
+    // Pick up framing information from the last header. Returns false if
+    // it is malformed.
+    bool checkHeader(Response &resp)
+    {
+        Response::HeaderItem &h = resp.headers.back();
+
+        if( strcasecmp(h.name.c_str(), "Content-Length") == 0 )
+        {
+            if( !parseContentLength(h.value, contentSize) )
+                return false;
+
+            headerContentLength = contentSize;
+        }
+        else if( strcasecmp(h.name.c_str(), "Transfer-Encoding") == 0 )
+        {
+            if(strcasecmp(h.value.c_str(), "chunked") == 0)
+                chunked = true;
+        }
+
+        return true;
+    }
+
+    // Content-Length is one or more decimal digits, optionally surrounded
+    // by spaces or tabs. Anything else, or a value that does not fit in a
+    // size_t, is an error rather than a guess.
+    static bool parseContentLength(const std::string &value, size_t &length)
+    {
+        std::string::const_iterator it = value.begin();
+        length = 0;
+
+        while( it != value.end() && (*it == ' ' || *it == '\t') )
+            ++it;
+
+        if( it == value.end() || *it < '0' || *it > '9' )
+            return false;
+
+        for(; it != value.end() && *it >= '0' && *it <= '9'; ++it)
+        {
+            size_t digit = *it - '0';
+
+            if( length > (SIZE_MAX - digit) / 10 )
+                return false;
+
+            length = length * 10 + digit;
+        }
+
+        while( it != value.end() && (*it == ' ' || *it == '\t') )
+            ++it;
+
+        return it == value.end();
+    }
+
+    // Called after the blank line that ends the head. Returns
+    // ParsingIncompleted if a body follows.
+    ParseResult finishHeaders(Response &resp)
+    {
+        std::vector<Response::HeaderItem>::iterator it = std::find_if(resp.headers.begin(),
+                                                            resp.headers.end(),
+                                                            checkIfConnection);
+
+        if( it != resp.headers.end() )
+        {
+            if( strcasecmp(it->value.c_str(), "Keep-Alive") == 0 )
+            {
+                resp.keepAlive = true;
+            }
+            else  // == Close
+            {
+                resp.keepAlive = false;
+            }
+        }
+        else
+        {
+            if( resp.versionMajor > 1 || (resp.versionMajor == 1 && resp.versionMinor == 1) )
+                resp.keepAlive = true;
+        }
+
+        if( chunked )
+        {
+            state = ChunkSize;
+        }
+        else if( contentSize == 0 )
+        {
+            return ParsingCompleted;
+        }
+        else
+        {
+            state = Post;
+        }
+
+        if( stopAfterHeaders )
+        {
+            return HeadersCompleted;
+        }
+
+        return ParsingIncompleted;
+    }
+
+    // First phase of setWaitForHead() mode: find the end of the head, then
+    // parse all of it at once and continue with the body, if any.
+    ParseResult consumeHead(Response &resp, const char *&begin, const char *end)
+    {
+        const char *headEnd = findHeadEnd(begin, end);
+
+        if( headEnd == NULL )
+            return ParsingIncompleted;
+
+        headScanned = 0;
+
+        const char *it = begin;
+        ParseResult result = parseHead(resp, it, headEnd);
+
+        if( result == ParsingIncompleted )
+        {
+            // Folded header lines and odd status lines are left to the
+            // state machine.
+            clearHead(resp);
+            return consume(resp, begin, end);
+        }
+        else if( result == ParsingError )
+        {
+            return result;
+        }
+
+        begin = headEnd;
+        result = finishHeaders(resp);
+
+        if( result != ParsingIncompleted )
+            return result;
+
+        return consume(resp, begin, end);
+    }
+
+    // Find the byte after the blank line that ends the head, or return NULL
+    // and remember how far the search went. memchr() is vectorized by the C
+    // library, so whole header lines are skipped at once.
+    const char *findHeadEnd(const char *begin, const char *end)
+    {
+        const char *p = begin + headScanned;
+
+        while( p != end )
+        {
+            p = static_cast<const char *>(memchr(p, '\n', end - p));
+
+            if( p == NULL )
+                break;
+
+            if( p - begin >= 3 && p[-1] == '\r' && p[-2] == '\n' && p[-3] == '\r' )
+                return p + 1;
+
+            ++p;
+        }
+
+        // The check above looks back from each '\n', so a blank line split
+        // across calls is still found.
+        headScanned = end - begin;
+        return NULL;
+    }
+
+    // Parse the complete head [begin, headEnd) straight from the buffer.
+    // Accepts and rejects exactly what the state machine does, except that
+    // input it does not handle (folded header lines, control characters in
+    // the reason phrase) yields ParsingIncompleted.
+    ParseResult parseHead(Response &resp, const char *&begin, const char *headEnd)
+    {
+        const char *p = begin;
+
+        // HTTP-version
+        if( headEnd - p < 5 || memcmp(p, "HTTP/", 5) != 0 )
+            return ParsingError;
+
+        p += 5;
+
+        if( !parseNumber(p, '.', resp.versionMajor) ||
+            !parseNumber(p, ' ', resp.versionMinor) ||
+            !parseNumber(p, ' ', resp.statusCode) )
+        {
+            return ParsingError;
+        }
+
+        if( resp.statusCode < 100 || resp.statusCode > 999 )
+            return ParsingError;
+
+        // Reason phrase, at least one character
+        const char *token = p;
+
+        for(; *p != '\r' || p == token; ++p)
+        {
+            if( isControl(*p) )
+                return ParsingIncompleted;
+            else if( !isChar(*p) )
+                return ParsingError;
+        }
+
+        if( p[1] != '\n' )
+            return ParsingError;
+
+        resp.status.assign(token, p);
+        p += 2;
+
+        if( layout )
+            layout->startLine.length = offsetOf(p);
+
+        // Header fields
+        while( *p != '\r' )
+        {
+            if( *p == ' ' || *p == '\t' )
+                return ParsingIncompleted;
+
+            const char *line = p;
+
+            for(token = p; *p != ':'; ++p)
+            {
+                if( !isToken(*p) )
+                    return ParsingError;
+            }
+
+            if( p == token || p[1] != ' ' )
+                return ParsingError;
+
+            addHeader(resp);
+            resp.headers.back().name.assign(token, p);
+
+            for(token = p += 2; *p != '\r'; ++p)
+            {
+                if( isControl(*p) )
+                    return ParsingError;
+            }
+
+            if( p[1] != '\n' )
+                return ParsingError;
+
+            resp.headers.back().value.assign(token, p);
+            p += 2;
+
+            if( !checkHeader(resp) )
+                return ParsingError;
+
+            if( layout )
+                layout->headers.push_back(MessageLayout::Span(offsetOf(line), p - line));
+        }
+
+        if( p + 2 != headEnd )
+            return ParsingError;
+
+        if( layout )
+            layout->headSize = offsetOf(headEnd);
+
+        return ParsingCompleted;
+    }
+
+    // Parse one or more digits followed by `terminator`.
+    template<typename T>
+    bool parseNumber(const char *&p, char terminator, T &value)
+    {
+        if( !isDigit(*p) )
+            return false;
+
+        for(value = 0; isDigit(*p); ++p)
+            value = value * 10 + *p - '0';
+
+        return *p++ == terminator;
+    }
+
+    // Undo a partial parseHead() before the state machine starts over.
+    void clearHead(Response &resp)
+    {
+        resp.status.clear();
+        resp.headers.clear();
+
+        contentSize = 0;
+        headerContentLength = 0;
+        chunked = false;
+
+        if( layout )
+            layout->clear();
+    }
+
+    // Offset of `p`, a pointer into the current parse() input, from the
+    // beginning of the message.
+    size_t offsetOf(const char *p) const
+    {
+        return messageOffset + (p - inputBegin);
+    }
+
+    // Compare the 8 bytes at `p` with the start of `literal` as a single
+    // word. memcpy() keeps the load unaligned-safe and compiles to one
+    // load; the literal side folds into a constant.
+    static inline bool equal8(const char *p, const char *literal)
+    {
+        uint64_t a, b;
+        memcpy(&a, p, 8);
+        memcpy(&b, literal, 8);
+        return a == b;
+    }
+
+    // Check if a byte may appear in a header name.
+    inline bool isToken(int c)
+    {
+        return isChar(c) && !isControl(c) && !isSpecial(c);
+    }
+
     // Check if a byte is an HTTP character.
     inline bool isChar(int c)
     {
@@ -559,49 +1033,40 @@ private:
         return c >= '0' && c <= '9';
     }
 
+    // Check if a byte is a hexadecimal digit.
+    inline bool isHexDigit(int c)
+    {
+        return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+    }
+
+    inline size_t hexValue(int c)
+    {
+        if( isDigit(c) )
+            return c - '0';
+        else if( c >= 'a' && c <= 'f' )
+            return c - 'a' + 10;
+        else
+            return c - 'A' + 10;
+    }
+
     // The current state of the parser.
     enum State
     {
-        ResponseStatusStart,
-        ResponseHttpVersion_ht,
-        ResponseHttpVersion_htt,
-        ResponseHttpVersion_http,
-        ResponseHttpVersion_slash,
-        ResponseHttpVersion_majorStart,
-        ResponseHttpVersion_major,
-        ResponseHttpVersion_minorStart,
-        ResponseHttpVersion_minor,
-        ResponseHttpVersion_statusCodeStart,
-        ResponseHttpVersion_statusCode,
-        ResponseHttpVersion_statusTextStart,
-        ResponseHttpVersion_statusText,
-        ResponseHttpVersion_newLine,
-        HeaderLineStart,
-        HeaderLws,
-        HeaderName,
-        SpaceBeforeHeaderValue,
-        HeaderValue,
-        ExpectingNewline_2,
-        ExpectingNewline_3,
-        Post,
-        ChunkSize,
-        ChunkExtensionName,
-        ChunkExtensionValue,
-        ChunkSizeNewLine,
-        ChunkSizeNewLine_2,
-        ChunkSizeNewLine_3,
-        ChunkTrailerName,
-        ChunkTrailerValue,
-
-        ChunkDataNewLine_1,
-        ChunkDataNewLine_2,
-        ChunkData,
+        HTTPPARSER_RESPONSE_STATES(HTTPPARSER_STATE_ENUM)
     } state;
 
     size_t contentSize;
-    std::string chunkSizeStr;
+    size_t headerContentLength;
     size_t chunkSize;
     bool chunked;
+    bool stopAfterHeaders;
+    bool discardBody;
+    bool waitForHead;
+    size_t headScanned;
+    MessageLayout *layout;
+    const char *inputBegin;
+    size_t messageOffset;
+    size_t consumedSize;
 };
 
 } // namespace httpparser
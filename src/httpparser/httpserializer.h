@@ -0,0 +1,347 @@
+/*
+ * Copyright (C) Alex Nekipelov (alex@nekipelov.net)
+ * License: MIT
+ */
+
+#ifndef HTTPPARSER_HTTPSERIALIZER_H
+#define HTTPPARSER_HTTPSERIALIZER_H
+
+#include <string>
+#include <vector>
+
+#include <string.h>
+#include <sys/uio.h>
+
+#include "request.h"
+#include "response.h"
+#include "httpstatus.h"
+
+namespace httpparser
+{
+
+// Writes requests and responses in wire format. Headers and content are
+// written exactly as they are stored in the message: nothing is added,
+// so the caller is responsible for Content-Length or Transfer-Encoding.
+class HttpSerializer
+{
+public:
+    // Append the message to `out`. The buffer grows at most once, so
+    // reusing it between messages avoids allocations entirely.
+    static void serialize(const Request &req, std::vector<char> &out)
+    {
+        size_t offset = out.size();
+        out.resize(offset + size(req));
+
+        char *ptr = &out[0] + offset;
+
+        ptr = append(ptr, req.method);
+        *ptr++ = ' ';
+        ptr = append(ptr, req.uri);
+
+        if( isHttp09(req) )
+        {
+            append(ptr, "\r\n", 2);
+            return;
+        }
+
+        *ptr++ = ' ';
+        ptr = appendVersion(ptr, req.versionMajor, req.versionMinor);
+        ptr = append(ptr, "\r\n", 2);
+        appendHeadersAndContent(ptr, req.headers, req.content);
+    }
+
+    // With `dateHeader` a "Date" header with the current time is written
+    // right after the status line.
+    static void serialize(const Response &resp, std::vector<char> &out, bool dateHeader = false)
+    {
+        size_t offset = out.size();
+        out.resize(offset + size(resp, dateHeader));
+
+        char *ptr = &out[0] + offset;
+        const char *line;
+        size_t lineSize;
+
+        if( standardStatusLine(resp, line, lineSize) )
+        {
+            ptr = append(ptr, line, lineSize);
+        }
+        else
+        {
+            ptr = appendVersion(ptr, resp.versionMajor, resp.versionMinor);
+            *ptr++ = ' ';
+            ptr = appendNumber(ptr, resp.statusCode);
+            *ptr++ = ' ';
+            ptr = append(ptr, resp.status);
+            ptr = append(ptr, "\r\n", 2);
+        }
+
+        if( dateHeader )
+            ptr = appendDate(ptr);
+
+        appendHeadersAndContent(ptr, resp.headers, resp.content);
+    }
+
+    // Number of bytes serialize() writes for the message.
+    static size_t size(const Request &req)
+    {
+        if( isHttp09(req) )
+            return req.method.size() + 1 + req.uri.size() + 2;
+
+        return req.method.size() + 1 + req.uri.size() + 1 + versionSize(req.versionMajor, req.versionMinor) + 2
+                + headersSize(req.headers) + 2 + req.content.size();
+    }
+
+    static size_t size(const Response &resp, bool dateHeader = false)
+    {
+        const char *line;
+        size_t lineSize;
+
+        if( !standardStatusLine(resp, line, lineSize) )
+        {
+            lineSize = versionSize(resp.versionMajor, resp.versionMinor) + 1 + numberSize(resp.statusCode) + 1
+                    + resp.status.size() + 2;
+        }
+
+        return lineSize + (dateHeader ? dateSize : 0) + headersSize(resp.headers) + 2 + resp.content.size();
+    }
+
+    // Number of iovec entries gather() needs for the message.
+    static size_t iovecCount(const Request &req)
+    {
+        if( isHttp09(req) )
+            return 4;
+
+        return 4 + req.headers.size() * 4 + 1 + (req.content.empty() ? 0 : 1);
+    }
+
+    static size_t iovecCount(const Response &resp, bool dateHeader = false)
+    {
+        const char *line;
+        size_t lineSize;
+        size_t statusLineCount = standardStatusLine(resp, line, lineSize) ? 1 : 3;
+
+        return statusLineCount + (dateHeader ? 1 : 0) + resp.headers.size() * 4 + 1
+                + (resp.content.empty() ? 0 : 1);
+    }
+
+    // Describe the message as `iov` entries pointing into the message
+    // itself, ready for a single writev(). Returns the number of entries
+    // used, or 0 if `count` is less than iovecCount(). The entries stay
+    // valid while the message is unchanged and until the next gather()
+    // call on this serializer, which owns the formatted version numbers.
+    size_t gather(const Request &req, struct iovec *iov, size_t count)
+    {
+        if( count < iovecCount(req) )
+            return 0;
+
+        size_t n = 0;
+
+        set(iov[n++], req.method.data(), req.method.size());
+        set(iov[n++], " ", 1);
+        set(iov[n++], req.uri.data(), req.uri.size());
+
+        if( isHttp09(req) )
+        {
+            set(iov[n++], "\r\n", 2);
+            return n;
+        }
+
+        char *ptr = scratch;
+        *ptr++ = ' ';
+        ptr = appendVersion(ptr, req.versionMajor, req.versionMinor);
+        ptr = append(ptr, "\r\n", 2);
+        set(iov[n++], scratch, ptr - scratch);
+
+        return gatherHeadersAndContent(iov, n, req.headers, req.content);
+    }
+
+    // Well-known status lines come from a static table and take a single
+    // entry; the Date header is copied into the serializer.
+    size_t gather(const Response &resp, struct iovec *iov, size_t count, bool dateHeader = false)
+    {
+        if( count < iovecCount(resp, dateHeader) )
+            return 0;
+
+        size_t n = 0;
+        char *ptr = scratch;
+        const char *line;
+        size_t lineSize;
+
+        if( standardStatusLine(resp, line, lineSize) )
+        {
+            set(iov[n++], line, lineSize);
+        }
+        else
+        {
+            ptr = appendVersion(ptr, resp.versionMajor, resp.versionMinor);
+            *ptr++ = ' ';
+            ptr = appendNumber(ptr, resp.statusCode);
+            *ptr++ = ' ';
+
+            set(iov[n++], scratch, ptr - scratch);
+            set(iov[n++], resp.status.data(), resp.status.size());
+            set(iov[n++], "\r\n", 2);
+        }
+
+        if( dateHeader )
+        {
+            set(iov[n++], ptr, dateSize);
+            ptr = appendDate(ptr);
+        }
+
+        return gatherHeadersAndContent(iov, n, resp.headers, resp.content);
+    }
+
+private:
+    template<typename HeaderItem>
+    static size_t headersSize(const std::vector<HeaderItem> &headers)
+    {
+        size_t result = 0;
+
+        for(typename std::vector<HeaderItem>::const_iterator it = headers.begin();
+            it != headers.end(); ++it)
+        {
+            result += it->name.size() + 2 + it->value.size() + 2;
+        }
+
+        return result;
+    }
+
+    template<typename HeaderItem>
+    static void appendHeadersAndContent(char *ptr, const std::vector<HeaderItem> &headers,
+                                        const std::vector<char> &content)
+    {
+        for(typename std::vector<HeaderItem>::const_iterator it = headers.begin();
+            it != headers.end(); ++it)
+        {
+            ptr = append(ptr, it->name);
+            ptr = append(ptr, ": ", 2);
+            ptr = append(ptr, it->value);
+            ptr = append(ptr, "\r\n", 2);
+        }
+
+        ptr = append(ptr, "\r\n", 2);
+
+        if( !content.empty() )
+            append(ptr, &content[0], content.size());
+    }
+
+    template<typename HeaderItem>
+    static size_t gatherHeadersAndContent(struct iovec *iov, size_t n,
+                                          const std::vector<HeaderItem> &headers,
+                                          const std::vector<char> &content)
+    {
+        for(typename std::vector<HeaderItem>::const_iterator it = headers.begin();
+            it != headers.end(); ++it)
+        {
+            set(iov[n++], it->name.data(), it->name.size());
+            set(iov[n++], ": ", 2);
+            set(iov[n++], it->value.data(), it->value.size());
+            set(iov[n++], "\r\n", 2);
+        }
+
+        set(iov[n++], "\r\n", 2);
+
+        if( !content.empty() )
+            set(iov[n++], &content[0], content.size());
+
+        return n;
+    }
+
+    // "Date: " + IMF-fixdate + "\r\n"
+    static const size_t dateSize = 6 + HttpDate::size + 2;
+
+    static char *appendDate(char *ptr)
+    {
+        ptr = append(ptr, "Date: ", 6);
+        ptr = append(ptr, HttpDate::now(), HttpDate::size);
+        return append(ptr, "\r\n", 2);
+    }
+
+    // Look up the pre-rendered status line if the response uses HTTP/1.1
+    // and the standard reason phrase for its code.
+    static bool standardStatusLine(const Response &resp, const char *&line, size_t &lineSize)
+    {
+        const size_t prefixSize = sizeof("HTTP/1.1 200 ") - 1;
+
+        if( resp.versionMajor != 1 || resp.versionMinor != 1 ||
+            !HttpStatus::statusLine(resp.statusCode, line, lineSize) )
+        {
+            return false;
+        }
+
+        return resp.status.size() == lineSize - prefixSize - 2 &&
+               memcmp(resp.status.data(), line + prefixSize, resp.status.size()) == 0;
+    }
+
+    static bool isHttp09(const Request &req)
+    {
+        return req.versionMajor == 0 && req.versionMinor == 9;
+    }
+
+    static void set(struct iovec &iov, const char *data, size_t size)
+    {
+        iov.iov_base = const_cast<char *>(data);
+        iov.iov_len = size;
+    }
+
+    static char *append(char *ptr, const char *data, size_t size)
+    {
+        memcpy(ptr, data, size);
+        return ptr + size;
+    }
+
+    static char *append(char *ptr, const std::string &str)
+    {
+        return append(ptr, str.data(), str.size());
+    }
+
+    static size_t numberSize(unsigned int value)
+    {
+        size_t result = 1;
+
+        while( value >= 10 )
+        {
+            value /= 10;
+            ++result;
+        }
+
+        return result;
+    }
+
+    static char *appendNumber(char *ptr, unsigned int value)
+    {
+        char *end = ptr + numberSize(value);
+        char *it = end;
+
+        do
+        {
+            *--it = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+        while( value != 0 );
+
+        return end;
+    }
+
+    static size_t versionSize(int major, int minor)
+    {
+        return 5 + numberSize(major) + 1 + numberSize(minor);
+    }
+
+    static char *appendVersion(char *ptr, int major, int minor)
+    {
+        ptr = append(ptr, "HTTP/", 5);
+        ptr = appendNumber(ptr, major);
+        *ptr++ = '.';
+        return appendNumber(ptr, minor);
+    }
+
+    // Large enough for " HTTP/<uint>.<uint>\r\n" or "HTTP/<uint>.<uint> <uint> "
+    // followed by the Date header.
+    char scratch[128];
+};
+
+} // namespace httpparser
+
+#endif // HTTPPARSER_HTTPSERIALIZER_H
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) Alex Nekipelov (alex@nekipelov.net)
+ * License: MIT
+ */
+
+#ifndef HTTPPARSER_HTTPSTATUS_H
+#define HTTPPARSER_HTTPSTATUS_H
+
+#include <stddef.h>
+#include <time.h>
+
+namespace httpparser
+{
+
+// Status codes with their standard reason phrases (RFC 7231 and friends).
+#define HTTPPARSER_STATUS_CODES(X) \
+    X(100, "Continue") \
+    X(101, "Switching Protocols") \
+    X(200, "OK") \
+    X(201, "Created") \
+    X(202, "Accepted") \
+    X(203, "Non-Authoritative Information") \
+    X(204, "No Content") \
+    X(205, "Reset Content") \
+    X(206, "Partial Content") \
+    X(300, "Multiple Choices") \
+    X(301, "Moved Permanently") \
+    X(302, "Found") \
+    X(303, "See Other") \
+    X(304, "Not Modified") \
+    X(305, "Use Proxy") \
+    X(307, "Temporary Redirect") \
+    X(308, "Permanent Redirect") \
+    X(400, "Bad Request") \
+    X(401, "Unauthorized") \
+    X(402, "Payment Required") \
+    X(403, "Forbidden") \
+    X(404, "Not Found") \
+    X(405, "Method Not Allowed") \
+    X(406, "Not Acceptable") \
+    X(407, "Proxy Authentication Required") \
+    X(408, "Request Timeout") \
+    X(409, "Conflict") \
+    X(410, "Gone") \
+    X(411, "Length Required") \
+    X(412, "Precondition Failed") \
+    X(413, "Payload Too Large") \
+    X(414, "URI Too Long") \
+    X(415, "Unsupported Media Type") \
+    X(416, "Range Not Satisfiable") \
+    X(417, "Expectation Failed") \
+    X(421, "Misdirected Request") \
+    X(422, "Unprocessable Entity") \
+    X(426, "Upgrade Required") \
+    X(428, "Precondition Required") \
+    X(429, "Too Many Requests") \
+    X(431, "Request Header Fields Too Large") \
+    X(500, "Internal Server Error") \
+    X(501, "Not Implemented") \
+    X(502, "Bad Gateway") \
+    X(503, "Service Unavailable") \
+    X(504, "Gateway Timeout") \
+    X(505, "HTTP Version Not Supported")
+
+class HttpStatus
+{
+public:
+    // Standard reason phrase for `code`, or NULL for unknown codes.
+    static const char *reasonPhrase(unsigned int code)
+    {
+        switch( code )
+        {
+#define HTTPPARSER_REASON_PHRASE(code, reason) \
+        case code: return reason;
+        HTTPPARSER_STATUS_CODES(HTTPPARSER_REASON_PHRASE)
+#undef HTTPPARSER_REASON_PHRASE
+        default:
+            return NULL;
+        }
+    }
+
+    // Pre-rendered "HTTP/1.1 <code> <reason>\r\n" for `code`. Returns false
+    // for unknown codes.
+    static bool statusLine(unsigned int code, const char *&data, size_t &size)
+    {
+        switch( code )
+        {
+#define HTTPPARSER_STATUS_LINE(code, reason) \
+        case code: \
+            data = "HTTP/1.1 " #code " " reason "\r\n"; \
+            size = sizeof("HTTP/1.1 " #code " " reason "\r\n") - 1; \
+            return true;
+        HTTPPARSER_STATUS_CODES(HTTPPARSER_STATUS_LINE)
+#undef HTTPPARSER_STATUS_LINE
+        default:
+            return false;
+        }
+    }
+};
+
+// IMF-fixdate ("Sun, 06 Nov 1994 08:49:37 GMT") for the Date header.
+class HttpDate
+{
+public:
+    enum { size = 29 };
+
+    // The current time, re-rendered at most once per second in each thread.
+    // The returned text is not null-terminated and stays valid in the
+    // calling thread until the next call.
+    static const char *now()
+    {
+        static thread_local Cache cache = { static_cast<time_t>(-1), { 0 } };
+
+        time_t current = time(NULL);
+
+        if( current != cache.second )
+        {
+            format(current, cache.text);
+            cache.second = current;
+        }
+
+        return cache.text;
+    }
+
+    // Render `t` into `out`, which must have room for `size` bytes.
+    static void format(time_t t, char *out)
+    {
+        static const char days[] = "SunMonTueWedThuFriSat";
+        static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+        struct tm tm;
+        gmtime_r(&t, &tm);
+
+        out = copy(out, days + tm.tm_wday * 3, 3);
+        *out++ = ',';
+        *out++ = ' ';
+        out = twoDigits(out, tm.tm_mday);
+        *out++ = ' ';
+        out = copy(out, months + tm.tm_mon * 3, 3);
+        *out++ = ' ';
+        out = twoDigits(out, (tm.tm_year + 1900) / 100);
+        out = twoDigits(out, (tm.tm_year + 1900) % 100);
+        *out++ = ' ';
+        out = twoDigits(out, tm.tm_hour);
+        *out++ = ':';
+        out = twoDigits(out, tm.tm_min);
+        *out++ = ':';
+        out = twoDigits(out, tm.tm_sec);
+        copy(out, " GMT", 4);
+    }
+
+private:
+    struct Cache
+    {
+        time_t second;
+        char text[size];
+    };
+
+    static char *copy(char *out, const char *text, size_t count)
+    {
+        for(size_t i = 0; i < count; ++i)
+            *out++ = text[i];
+
+        return out;
+    }
+
+    static char *twoDigits(char *out, int value)
+    {
+        *out++ = static_cast<char>('0' + value / 10);
+        *out++ = static_cast<char>('0' + value % 10);
+        return out;
+    }
+};
+
+} // namespace httpparser
+
+#endif // HTTPPARSER_HTTPSTATUS_H
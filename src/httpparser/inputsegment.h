@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) Alex Nekipelov (alex@nekipelov.net)
+ * License: MIT
+ */
+
+#ifndef HTTPPARSER_INPUTSEGMENT_H
+#define HTTPPARSER_INPUTSEGMENT_H
+
+#include <stddef.h>
+
+namespace httpparser
+{
+
+// One piece of input that is not contiguous with the next, e.g. one iovec
+// filled by readv() or one of the two halves of a ring buffer.
+struct InputSegment
+{
+    const char *data;
+    size_t size;
+};
+
+namespace detail
+{
+
+// Feed the segments to parser.parse() in order, as if they were one range.
+// A parser uses every byte while a message is incomplete, so a token split
+// between segments is simply continued by the next call. Stops at the end
+// of a message, at an error, or at a segment the parser did not use up
+// (a head it waits for as a whole). `consumed` is set to the bytes used
+// over all segments.
+template<typename Parser, typename Message>
+typename Parser::ParseResult parseSegments(Parser &parser, Message &msg,
+                                           const InputSegment *segments, size_t count,
+                                           size_t &consumed)
+{
+    typename Parser::ParseResult result = Parser::ParsingIncompleted;
+    consumed = 0;
+
+    for(size_t i = 0; i < count; ++i)
+    {
+        result = parser.parse(msg, segments[i].data, segments[i].data + segments[i].size);
+        consumed += parser.consumed();
+
+        if( result != Parser::ParsingIncompleted || parser.consumed() < segments[i].size )
+            break;
+    }
+
+    return result;
+}
+
+} // namespace detail
+
+} // namespace httpparser
+
+#endif // HTTPPARSER_INPUTSEGMENT_H
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) Alex Nekipelov (alex@nekipelov.net)
+ * License: MIT
+ */
+
+#ifndef HTTPPARSER_MESSAGELAYOUT_H
+#define HTTPPARSER_MESSAGELAYOUT_H
+
+#include <vector>
+#include <stddef.h>
+
+namespace httpparser
+{
+
+// Where the parts of a message were found in the raw input. Offsets count
+// bytes from the first byte of the message across all parse() calls, so a
+// proxy can forward untouched parts verbatim and rewrite only what it must.
+struct MessageLayout
+{
+    MessageLayout()
+        : headSize(0), size(0)
+    {}
+
+    struct Span
+    {
+        Span() : offset(0), length(0)
+        {}
+
+        Span(size_t offset, size_t length) : offset(offset), length(length)
+        {}
+
+        size_t offset;
+        size_t length;
+    };
+
+    // Request or status line including its CRLF.
+    Span startLine;
+
+    // One entry per parsed header, each covering the whole header line
+    // (continuation lines included) and its CRLF. Entry i describes
+    // headers[i] of the message.
+    std::vector<Span> headers;
+
+    // Size of the head: start line, headers and the blank line.
+    size_t headSize;
+
+    // Body payload. A Content-Length body is a single span, a chunked body
+    // has one span per chunk; the chunk framing lies between them.
+    std::vector<Span> body;
+
+    // Number of message bytes seen so far.
+    size_t size;
+
+    void clear()
+    {
+        startLine = Span();
+        headers.clear();
+        headSize = 0;
+        body.clear();
+        size = 0;
+    }
+
+    void addBody(size_t offset, size_t length)
+    {
+        if( !body.empty() && body.back().offset + body.back().length == offset )
+            body.back().length += length;
+        else
+            body.push_back(Span(offset, length));
+    }
+};
+
+} // namespace httpparser
+
+#endif // HTTPPARSER_MESSAGELAYOUT_H
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) Alex Nekipelov (alex@nekipelov.net)
+ * License: MIT
+ */
+
+#ifndef HTTPPARSER_PARSERDISPATCH_H
+#define HTTPPARSER_PARSERDISPATCH_H
+
+// Per-byte dispatch of the parser state machines, chosen at compile time.
+//
+// By default consume() is a switch over the current state inside a loop.
+// Define HTTPPARSER_COMPUTED_GOTO before including the parsers to make each
+// state handler fetch the next byte itself and jump straight to the handler
+// of the next state through a table of label addresses. Every handler then
+// ends in its own indirect jump, which the branch predictor can learn per
+// state, and the bounds check of the switch goes away. This needs the
+// labels-as-values extension of GCC and Clang.
+//
+// The state lists are X-macros so that the enum and the jump table are
+// generated from the same list and cannot disagree.
+
+#if defined(HTTPPARSER_COMPUTED_GOTO) && !defined(__GNUC__)
+#error "HTTPPARSER_COMPUTED_GOTO requires GCC or Clang"
+#endif
+
+#define HTTPPARSER_STATE_ENUM(name) name,
+
+#ifdef HTTPPARSER_COMPUTED_GOTO
+
+#define HTTPPARSER_STATE_LABEL(name) &&state_##name,
+
+// Jump to the handler of the current state; used once, before the switch.
+#define HTTPPARSER_DISPATCH(states) \
+    static const void *const dispatchTable[] = { states(HTTPPARSER_STATE_LABEL) }; \
+    goto *dispatchTable[state]
+
+// Start of the handler for state `name`.
+#define HTTPPARSER_CASE(name) case name: state_##name
+
+// End of a handler: continue with the next byte.
+#define HTTPPARSER_NEXT \
+    do { \
+        if( begin == end ) \
+            return ParsingIncompleted; \
+        input = *begin++; \
+        goto *dispatchTable[state]; \
+    } while( false )
+
+#else
+
+#define HTTPPARSER_DISPATCH(states)
+#define HTTPPARSER_CASE(name) case name
+#define HTTPPARSER_NEXT break
+
+#endif
+
+#endif // HTTPPARSER_PARSERDISPATCH_H
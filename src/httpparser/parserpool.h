@@ -0,0 +1,302 @@
+/*
+ * Copyright (C) Alex Nekipelov (alex@nekipelov.net)
+ * License: MIT
+ */
+
+#ifndef HTTPPARSER_PARSERPOOL_H
+#define HTTPPARSER_PARSERPOOL_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "request.h"
+#include "response.h"
+
+namespace httpparser
+{
+
+// Recycles parser and message pairs between connections, so that a new
+// connection gets a message whose strings and vectors already have
+// capacity instead of growing them from scratch.
+//
+// The pool owns a fixed number of entries on a lock-free free-list and may
+// be shared by any number of threads. Each thread should put a LocalCache
+// in front of it to take and return entries without touching shared
+// memory most of the time. When the pool is empty acquire() allocates an
+// entry on the heap; release() deletes such entries.
+//
+//     ParserPool<HttpRequestParser, Request> pool(1024);
+//     ParserPool<HttpRequestParser, Request>::LocalCache cache(pool);
+//
+//     ParserPool<HttpRequestParser, Request>::Entry *entry = cache.acquire();
+//     entry->parser.parse(entry->message, begin, end);
+//     ...
+//     cache.release(entry);
+template<typename Parser, typename Message>
+class ParserPool
+{
+public:
+    // Memory an entry may keep when it is returned. Anything larger is
+    // freed, so one huge upload does not pin its buffer forever.
+    struct Limits
+    {
+        Limits()
+            : headersReserve(16), maxHeaders(64), maxContentCapacity(64 * 1024),
+              maxStringCapacity(4096)
+        {}
+
+        size_t headersReserve;      // header slots reserved up front
+        size_t maxHeaders;          // header vector capacity kept
+        size_t maxContentCapacity;  // content capacity kept
+        size_t maxStringCapacity;   // capacity kept by each string
+    };
+
+    struct Entry
+    {
+        Entry() : next(0), index(notPooled)
+        {}
+
+        Parser parser;
+        Message message;
+
+    private:
+        friend class ParserPool;
+
+        std::atomic<uint32_t> next;  // free-list link: index + 1, 0 ends
+        uint32_t index;              // position in the pool or notPooled
+    };
+
+    explicit ParserPool(size_t capacity, const Limits &limits = Limits())
+        : entries(capacity), limits(limits), head(0)
+    {
+        for(size_t i = capacity; i > 0; --i)
+        {
+            Entry &entry = entries[i - 1];
+            entry.index = static_cast<uint32_t>(i - 1);
+            reserve(entry.message);
+            push(entry);
+        }
+    }
+
+    // Take a fresh parser and an empty message.
+    Entry *acquire()
+    {
+        Entry *entry = pop();
+
+        if( entry == NULL )
+        {
+            entry = new Entry;
+            reserve(entry->message);
+        }
+
+        return entry;
+    }
+
+    // Return an entry taken from this pool. The message is cleared.
+    void release(Entry *entry)
+    {
+        if( entry->index == notPooled )
+        {
+            delete entry;
+        }
+        else
+        {
+            recycle(*entry);
+            push(*entry);
+        }
+    }
+
+    // Number of entries owned by the pool.
+    size_t capacity() const
+    {
+        return entries.size();
+    }
+
+    // Entries owned by one thread, in front of the shared free-list. Must
+    // not outlive the pool; remaining entries go back to it on destruction.
+    class LocalCache
+    {
+    public:
+        explicit LocalCache(ParserPool &pool)
+            : pool(pool), count(0)
+        {}
+
+        ~LocalCache()
+        {
+            flush();
+        }
+
+        Entry *acquire()
+        {
+            if( count > 0 )
+                return cached[--count];
+
+            return pool.acquire();
+        }
+
+        void release(Entry *entry)
+        {
+            if( count < cacheSize && entry->index != notPooled )
+            {
+                pool.recycle(*entry);
+                cached[count++] = entry;
+            }
+            else
+            {
+                pool.release(entry);
+            }
+        }
+
+        // Give all cached entries back to the pool.
+        void flush()
+        {
+            while( count > 0 )
+                pool.push(*cached[--count]);
+        }
+
+    private:
+        LocalCache(const LocalCache &);
+        LocalCache &operator=(const LocalCache &);
+
+        enum { cacheSize = 16 };
+
+        ParserPool &pool;
+        Entry *cached[cacheSize];
+        size_t count;
+    };
+
+private:
+    ParserPool(const ParserPool &);
+    ParserPool &operator=(const ParserPool &);
+
+    static const uint32_t notPooled = 0xffffffff;
+
+    // The free-list head packs the index + 1 of the first free entry (0 if
+    // there is none) in the low half and a counter bumped on every change
+    // in the high half, so a compare-and-swap fails if the head was popped
+    // and pushed back in between (the ABA problem).
+    Entry *pop()
+    {
+        uint64_t current = head.load(std::memory_order_acquire);
+
+        for(;;)
+        {
+            uint32_t first = static_cast<uint32_t>(current);
+
+            if( first == 0 )
+                return NULL;
+
+            Entry &entry = entries[first - 1];
+            uint64_t replacement = nextTag(current) | entry.next.load(std::memory_order_relaxed);
+
+            if( head.compare_exchange_weak(current, replacement,
+                                           std::memory_order_acquire, std::memory_order_acquire) )
+            {
+                return &entry;
+            }
+        }
+    }
+
+    void push(Entry &entry)
+    {
+        uint64_t current = head.load(std::memory_order_relaxed);
+        uint64_t replacement;
+
+        do
+        {
+            entry.next.store(static_cast<uint32_t>(current), std::memory_order_relaxed);
+            replacement = nextTag(current) | (entry.index + 1);
+        }
+        while( !head.compare_exchange_weak(current, replacement,
+                                           std::memory_order_release, std::memory_order_relaxed) );
+    }
+
+    static uint64_t nextTag(uint64_t current)
+    {
+        return ((current >> 32) + 1) << 32;
+    }
+
+    void reserve(Message &msg)
+    {
+        msg.headers.reserve(limits.headersReserve);
+        msg.spareHeaders.reserve(limits.headersReserve);
+    }
+
+    // Make a returned entry look new, keeping memory within the limits.
+    // The header items stay alive in spareHeaders, so the parser does not
+    // allocate their strings again.
+    void recycle(Entry &entry)
+    {
+        entry.parser = Parser();
+        entry.message.reset();
+        trim(entry.message);
+    }
+
+    void trim(Request &req)
+    {
+        trimString(req.method);
+        trimString(req.uri);
+        trimCommon(req);
+    }
+
+    void trim(Response &resp)
+    {
+        trimString(resp.status);
+        trimCommon(resp);
+    }
+
+    template<typename T>
+    void trimCommon(T &msg)
+    {
+        typedef typename T::HeaderItem HeaderItem;
+
+        if( msg.headers.capacity() > limits.maxHeaders )
+        {
+            std::vector<HeaderItem>().swap(msg.headers);
+            msg.headers.reserve(limits.headersReserve);
+        }
+
+        if( msg.spareHeaders.capacity() > limits.maxHeaders )
+        {
+            // Keep the first maxHeaders items, strings and all.
+            std::vector<HeaderItem> spare;
+            spare.reserve(limits.headersReserve);
+
+            for(size_t i = 0; i < msg.spareHeaders.size() && i < limits.maxHeaders; ++i)
+            {
+                spare.push_back(HeaderItem());
+                spare.back().name.swap(msg.spareHeaders[i].name);
+                spare.back().value.swap(msg.spareHeaders[i].value);
+            }
+
+            spare.swap(msg.spareHeaders);
+        }
+
+        for(size_t i = 0; i < msg.spareHeaders.size(); ++i)
+        {
+            trimString(msg.spareHeaders[i].name);
+            trimString(msg.spareHeaders[i].value);
+        }
+
+        if( msg.content.capacity() > limits.maxContentCapacity )
+            std::vector<char>().swap(msg.content);
+    }
+
+    void trimString(std::string &str)
+    {
+        if( str.capacity() > limits.maxStringCapacity )
+            std::string().swap(str);
+    }
+
+    std::vector<Entry> entries;
+    Limits limits;
+    std::atomic<uint64_t> head;
+};
+
+} // namespace httpparser
+
+#endif // HTTPPARSER_PARSERPOOL_H
@@ -15,7 +15,7 @@ namespace httpparser
 
 struct Request {
     Request()
-        : versionMajor(0), versionMinor(0), keepAlive(false)
+        : uriForm(OriginForm), versionMajor(0), versionMinor(0), keepAlive(false)
     {}
     
     struct HeaderItem
@@ -24,14 +24,102 @@ struct Request {
         std::string value;
     };
 
+    // Form of the request-target (RFC 7230, section 5.3).
+    enum UriForm
+    {
+        OriginForm,     // "/path?query"
+        AbsoluteForm,   // "http://example.com/path?query", sent to proxies
+        AuthorityForm,  // "example.com:443", sent with CONNECT
+        AsteriskForm    // "*", sent with OPTIONS
+    };
+
+    // Part of `uri` found by the parser while it scanned the request-target.
+    struct UriRange
+    {
+        UriRange() : offset(0), length(0)
+        {}
+
+        size_t offset;
+        size_t length;
+    };
+
     std::string method;
     std::string uri;
+    UriForm uriForm;
+    UriRange uriAuthority;
+    UriRange uriPath;
+    UriRange uriQuery;
+    UriRange uriFragment;
     int versionMajor;
     int versionMinor;
     std::vector<HeaderItem> headers;
+    // Header items dropped by reset(), emptied but still holding their
+    // memory; the parser fills these before making new ones.
+    std::vector<HeaderItem> spareHeaders;
     std::vector<char> content;
     bool keepAlive;
 
+    std::string authority() const
+    {
+        return uri.substr(uriAuthority.offset, uriAuthority.length);
+    }
+
+    std::string path() const
+    {
+        if( uriForm == AbsoluteForm && uriPath.length == 0 )
+            return "/";
+        else
+            return uri.substr(uriPath.offset, uriPath.length);
+    }
+
+    std::string query() const
+    {
+        return uri.substr(uriQuery.offset, uriQuery.length);
+    }
+
+    std::string fragment() const
+    {
+        return uri.substr(uriFragment.offset, uriFragment.length);
+    }
+
+    // Reset to a default-constructed request but keep the memory of the
+    // strings and vectors for the next message.
+    void clear()
+    {
+        method.clear();
+        uri.clear();
+        uriForm = OriginForm;
+        uriAuthority = UriRange();
+        uriPath = UriRange();
+        uriQuery = UriRange();
+        uriFragment = UriRange();
+        versionMajor = 0;
+        versionMinor = 0;
+        headers.clear();
+        content.clear();
+        keepAlive = false;
+    }
+
+    // Like clear(), but move the header items to spareHeaders instead of
+    // destroying them, so the next message parsed into this one reuses the
+    // memory of their strings too.
+    void reset()
+    {
+        while( !headers.empty() )
+        {
+            HeaderItem &item = headers.back();
+            item.name.clear();
+            item.value.clear();
+
+            spareHeaders.push_back(HeaderItem());
+            spareHeaders.back().name.swap(item.name);
+            spareHeaders.back().value.swap(item.value);
+            headers.pop_back();
+        }
+
+        clear();
+    }
+
     std::string inspect() const
     {
         std::stringstream stream;
@@ -27,12 +27,48 @@ struct Response {
     int versionMajor;
     int versionMinor;
     std::vector<HeaderItem> headers;
+    // Header items dropped by reset(), emptied but still holding their
+    // memory; the parser fills these before making new ones.
+    std::vector<HeaderItem> spareHeaders;
     std::vector<char> content;
     bool keepAlive;
     
     unsigned int statusCode;
     std::string status;
 
+    // Reset to a default-constructed response but keep the memory of the
+    // strings and vectors for the next message.
+    void clear()
+    {
+        versionMajor = 0;
+        versionMinor = 0;
+        headers.clear();
+        content.clear();
+        keepAlive = false;
+        statusCode = 0;
+        status.clear();
+    }
+
+    // Like clear(), but move the header items to spareHeaders instead of
+    // destroying them, so the next message parsed into this one reuses the
+    // memory of their strings too.
+    void reset()
+    {
+        while( !headers.empty() )
+        {
+            HeaderItem &item = headers.back();
+            item.name.clear();
+            item.value.clear();
+
+            spareHeaders.push_back(HeaderItem());
+            spareHeaders.back().name.swap(item.name);
+            spareHeaders.back().value.swap(item.value);
+            headers.pop_back();
+        }
+
+        clear();
+    }
+
     std::string inspect() const
     {
         std::stringstream stream;
@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) Alex Nekipelov (alex@nekipelov.net)
+ * License: MIT
+ */
+
+#ifndef HTTPPARSER_URLBATCHPARSER_H
+#define HTTPPARSER_URLBATCHPARSER_H
+
+#include <vector>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "urlparser.h"
+
+namespace httpparser
+{
+
+// A url that is not owned by the parser, e.g. a slice of a memory-mapped log.
+struct UrlSpan
+{
+    const char *data;
+    size_t size;
+};
+
+// Parsed components of a batch stored as a struct of arrays. Element i of
+// every array describes urls[i]; ranges are relative to urls[i].data.
+struct UrlBatchResult
+{
+    std::vector<UrlParser::Range> scheme;
+    std::vector<UrlParser::Range> username;
+    std::vector<UrlParser::Range> password;
+    std::vector<UrlParser::Range> hostname;
+    std::vector<UrlParser::Range> port;
+    std::vector<UrlParser::Range> path;
+    std::vector<UrlParser::Range> query;
+    std::vector<UrlParser::Range> fragment;
+    std::vector<uint16_t> integerPort;
+    std::vector<uint8_t> hostType;  // UrlParser::HostType
+    std::vector<UrlParser::Address> address;
+    std::vector<UrlParser::Range> zone;
+    std::vector<uint8_t> valid;
+
+    // Indexes of the urls that failed to parse, in ascending order.
+    std::vector<size_t> invalid;
+
+    size_t size() const
+    {
+        return valid.size();
+    }
+
+    void resize(size_t count)
+    {
+        scheme.resize(count);
+        username.resize(count);
+        password.resize(count);
+        hostname.resize(count);
+        port.resize(count);
+        path.resize(count);
+        query.resize(count);
+        fragment.resize(count);
+        integerPort.resize(count);
+        hostType.resize(count);
+        address.resize(count);
+        zone.resize(count);
+        valid.resize(count);
+        invalid.clear();
+    }
+};
+
+// Parses batches of urls on a set of worker threads that live as long as
+// the parser, so a batch costs a wake-up rather than a thread start. One
+// batch at a time: parse() must not be called from several threads at
+// once.
+class UrlBatchParser
+{
+public:
+    // Batches smaller than this are not worth handing to another thread.
+    static const size_t minUrlsPerThread = 4096;
+
+    // Parse using up to `threads` threads, 0 means one per hardware thread.
+    // The calling thread is one of them; the others start here.
+    explicit UrlBatchParser(size_t threads = 0)
+        : threadCount(threads), batchUrls(NULL), batchResult(NULL),
+          activeWorkers(0), pending(0), generation(0), stopping(false)
+    {
+        if( threadCount == 0 )
+            threadCount = std::thread::hardware_concurrency();
+
+        if( threadCount == 0 )
+            threadCount = 1;
+
+        slots.resize(threadCount);
+        pool.reserve(threadCount - 1);
+
+        for(size_t i = 1; i < threadCount; ++i)
+            pool.push_back(std::thread(&UrlBatchParser::run, this, i));
+    }
+
+    ~UrlBatchParser()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+
+        wake.notify_all();
+
+        for(size_t i = 0; i < pool.size(); ++i)
+            pool[i].join();
+    }
+
+    size_t threads() const
+    {
+        return threadCount;
+    }
+
+    // Parse urls[0..count) into `result`. The storage of `result` is reused
+    // between calls, so keep it around when parsing many batches.
+    void parse(const UrlSpan *urls, size_t count, UrlBatchResult &result)
+    {
+        result.resize(count);
+
+        size_t workers = std::min(threadCount, (count + minUrlsPerThread - 1) / minUrlsPerThread);
+
+        if( workers <= 1 )
+        {
+            parseRange(urls, 0, count, result, result.invalid);
+            return;
+        }
+
+        // Every worker writes to its own slice of the result arrays and
+        // collects invalid indexes in its own slot, so no synchronization
+        // is needed until all of them are done.
+        size_t perWorker = (count + workers - 1) / workers;
+
+        for(size_t i = 0; i < workers; ++i)
+        {
+            slots[i].from = std::min(count, i * perWorker);
+            slots[i].to = std::min(count, slots[i].from + perWorker);
+            slots[i].invalid.clear();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            batchUrls = urls;
+            batchResult = &result;
+            activeWorkers = workers;
+            pending = workers - 1;
+            ++generation;
+        }
+
+        wake.notify_all();
+
+        parseRange(urls, slots[0].from, slots[0].to, result, slots[0].invalid);
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            while( pending > 0 )
+                done.wait(lock);
+        }
+
+        for(size_t i = 0; i < workers; ++i)
+            result.invalid.insert(result.invalid.end(), slots[i].invalid.begin(), slots[i].invalid.end());
+    }
+
+    void parse(const std::vector<UrlSpan> &urls, UrlBatchResult &result)
+    {
+        parse(urls.empty() ? NULL : &urls[0], urls.size(), result);
+    }
+
+private:
+    static void parseRange(const UrlSpan *urls, size_t from, size_t to,
+                           UrlBatchResult &result, std::vector<size_t> &invalid)
+    {
+        UrlParser::Components url;
+
+        for(size_t i = from; i < to; ++i)
+        {
+            bool ok = UrlParser::parseComponents(urls[i].data, urls[i].data + urls[i].size, url);
+
+            result.scheme[i] = url.scheme;
+            result.username[i] = url.username;
+            result.password[i] = url.password;
+            result.hostname[i] = url.hostname;
+            result.port[i] = url.port;
+            result.path[i] = url.path;
+            result.query[i] = url.query;
+            result.fragment[i] = url.fragment;
+            result.integerPort[i] = url.integerPort;
+            result.hostType[i] = static_cast<uint8_t>(url.hostType);
+            result.address[i] = url.address;
+            result.zone[i] = url.zone;
+            result.valid[i] = ok;
+
+            if( !ok )
+                invalid.push_back(i);
+        }
+    }
+
+    // Body of worker thread `index`: wait for a batch, parse its slice if
+    // the batch is big enough to need this worker, report back.
+    void run(size_t index)
+    {
+        uint64_t seen = 0;
+
+        for(;;)
+        {
+            const UrlSpan *urls;
+            UrlBatchResult *result;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+
+                while( !stopping && generation == seen )
+                    wake.wait(lock);
+
+                if( stopping )
+                    return;
+
+                seen = generation;
+
+                if( index >= activeWorkers )
+                    continue;
+
+                urls = batchUrls;
+                result = batchResult;
+            }
+
+            Slot &slot = slots[index];
+            parseRange(urls, slot.from, slot.to, *result, slot.invalid);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                if( --pending == 0 )
+                    done.notify_one();
+            }
+        }
+    }
+
+    UrlBatchParser(const UrlBatchParser &);
+    UrlBatchParser &operator=(const UrlBatchParser &);
+
+    enum {
+        cacheLine = 64
+    };
+
+    // The share of a batch of one thread. Each on its own cache line, as
+    // the invalid list is written while the neighbours work.
+    struct alignas(cacheLine) Slot
+    {
+        Slot() : from(0), to(0)
+        {}
+
+        size_t from;
+        size_t to;
+        std::vector<size_t> invalid;
+    };
+
+    size_t threadCount;
+    std::vector<Slot> slots;
+    std::vector<std::thread> pool;
+
+    // The current batch, guarded by `mutex`.
+    std::mutex mutex;
+    std::condition_variable wake;  // a new batch or stopping
+    std::condition_variable done;  // pending dropped to 0
+    const UrlSpan *batchUrls;
+    UrlBatchResult *batchResult;
+    size_t activeWorkers;
+    size_t pending;
+    uint64_t generation;
+    bool stopping;
+};
+
+} // namespace httpparser
+
+#endif // HTTPPARSER_URLBATCHPARSER_H
@@ -9,6 +9,9 @@
 #include <string>
 #include <stdlib.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <ctype.h>
 #include <assert.h>
 
 namespace httpparser
@@ -17,6 +20,55 @@ namespace httpparser
 class UrlParser
 {
 public:
+    // A component of the url as an offset/length pair relative to
+    // the beginning of the parsed text.
+    struct Range
+    {
+        Range() : offset(0), length(0)
+        {}
+
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    enum HostType
+    {
+        HostName,
+        HostIPv4,
+        HostIPv6
+    };
+
+    // Binary host address in network byte order. IPv4 addresses use
+    // the first four bytes.
+    struct Address
+    {
+        uint8_t bytes[16];
+    };
+
+    struct Components
+    {
+        Components() : integerPort(0), hostType(HostName)
+        {
+            memset(address.bytes, 0, sizeof(address.bytes));
+        }
+
+        Range scheme;
+        Range username;
+        Range password;
+        Range hostname;
+        Range port;
+        Range path;
+        Range query;
+        Range fragment;
+        uint16_t integerPort;
+
+        // Numeric hosts are decoded while parsing. For IPv6 literals the
+        // hostname is the text between the brackets without the zone id.
+        HostType hostType;
+        Address address;
+        Range zone;
+    };
+
     UrlParser()
         : valid(false)
     {
@@ -30,8 +82,8 @@ public:
 
     bool parse(const std::string &str)
     {
-        url = Url();
-        parse_(str);
+        source.assign(str);
+        valid = parseComponents(source.data(), source.data() + source.size(), url);
 
         return isValid();
     }
@@ -44,49 +96,72 @@ public:
     std::string scheme() const
     {
         assert( isValid() );
-        return url.scheme;
+        return component(url.scheme);
     }
 
     std::string username() const
     {
         assert( isValid() );
-        return url.username;
+        return component(url.username);
     }
 
     std::string password() const
     {
         assert( isValid() );
-        return url.password;
+        return component(url.password);
     }
 
     std::string hostname() const
     {
         assert( isValid() );
-        return url.hostname;
+        return component(url.hostname);
     }
 
     std::string port() const
     {
         assert( isValid() );
-        return url.port;
+        return component(url.port);
     }
 
     std::string path() const
     {
         assert( isValid() );
-        return url.path;
+
+        if( url.path.length == 0 )
+            return "/";
+        else
+            return component(url.path);
     }
 
     std::string query() const
     {
         assert( isValid() );
-        return url.query;
+        return component(url.query);
     }
 
     std::string fragment() const
     {
         assert( isValid() );
-        return url.fragment;
+        return component(url.fragment);
+    }
+
+    HostType hostType() const
+    {
+        assert( isValid() );
+        return url.hostType;
+    }
+
+    // Only meaningful when hostType() is HostIPv4 or HostIPv6.
+    const Address &address() const
+    {
+        assert( isValid() );
+        return url.address;
+    }
+
+    std::string zone() const
+    {
+        assert( isValid() );
+        return component(url.zone);
     }
 
     uint16_t httpPort() const
@@ -96,9 +171,9 @@ public:
 
         assert( isValid() );
 
-        if( url.port.empty() )
+        if( url.port.length == 0 )
         {
-            if( scheme() == "https" )
+            if( url.scheme.length == 5 && memcmp(source.data() + url.scheme.offset, "https", 5) == 0 )
                 return defaultHttpsPort;
             else
                 return defaultHttpPort;
@@ -109,25 +184,9 @@ public:
         }
     }
 
-private:
-    bool isUnreserved(char ch) const
-    {
-        if( isalnum(ch) )
-            return true;
-
-        switch(ch)
-        {
-        case '-':
-        case '.':
-        case '_':
-        case '~':
-            return true;
-        }
-
-        return false;
-    }
-
-    void parse_(const std::string &str)
+    // Split the url in [begin, end) into components without copying
+    // anything. Returns false and resets `result` if the url is invalid.
+    static bool parseComponents(const char *begin, const char *end, Components &result)
     {
         enum {
             Scheme,
@@ -137,6 +196,7 @@ private:
             Password,
             Hostname,
             IPV6Hostname,
+            AfterIPV6Hostname,
             PortOrPassword,
             Port,
             Path,
@@ -144,32 +204,39 @@ private:
             Fragment
         } state = Scheme;
 
-        std::string usernameOrHostname;
-        std::string portOrPassword;
+        result = Components();
+
+        if( end - begin > static_cast<ptrdiff_t>(UINT32_MAX) )
+            return false;
 
-        valid = true;
-        url.path = "/";
-        url.integerPort = 0;
+        const uint32_t size = static_cast<uint32_t>(end - begin);
 
-        for(size_t i = 0; i < str.size() && valid; ++i)
+        // Start of the component currently being scanned and, for
+        // the ambiguous "user:password@" / "host:port" case, the end
+        // of the part before the colon.
+        uint32_t start = 0;
+        uint32_t tokenStart = 0;
+        uint32_t tokenEnd = 0;
+
+        for(uint32_t i = 0; i < size; ++i)
         {
-            char ch = str[i];
+            char ch = begin[i];
 
             switch(state)
             {
             case Scheme:
                 if( isalnum(ch) || ch == '+' || ch == '-' || ch == '.')
                 {
-                    url.scheme += ch;
+                    // continue
                 }
                 else if( ch == ':' )
                 {
+                    setRange(result.scheme, 0, i);
                     state = SlashAfterScheme1;
                 }
                 else
                 {
-                    valid = false;
-                    url = Url();
+                    return invalid(result);
                 }
                 break;
             case SlashAfterScheme1:
@@ -179,191 +246,464 @@ private:
                 }
                 else if( isalnum(ch) )
                 {
-                    usernameOrHostname = ch;
+                    tokenStart = i;
                     state = UsernameOrHostname;
                 }
                 else
                 {
-                    valid = false;
-                    url = Url();
+                    return invalid(result);
                 }
                 break;
             case SlashAfterScheme2:
                 if( ch == '/' )
                 {
+                    tokenStart = i + 1;
                     state = UsernameOrHostname;
                 }
                 else
                 {
-                    valid = false;
-                    url = Url();
+                    return invalid(result);
                 }
                 break;
             case UsernameOrHostname:
-                if( isUnreserved(ch) || ch == '%' )
+                if( ch == '[' && i == tokenStart )
+                {
+                    start = i + 1;
+                    state = IPV6Hostname;
+                }
+                else if( isUnreserved(ch) || ch == '%' )
                 {
-                    usernameOrHostname += ch;
+                    // continue
                 }
                 else if( ch == ':' )
                 {
+                    tokenEnd = i;
+                    start = i + 1;
                     state = PortOrPassword;
                 }
                 else if( ch == '@' )
                 {
+                    setRange(result.username, tokenStart, i);
+                    start = i + 1;
                     state = Hostname;
-                    std::swap(url.username, usernameOrHostname);
                 }
                 else if( ch == '/' )
                 {
+                    setRange(result.hostname, tokenStart, i);
+                    start = i;
                     state = Path;
-                    std::swap(url.hostname, usernameOrHostname);
                 }
                 else
                 {
-                    valid = false;
-                    url = Url();
+                    return invalid(result);
                 }
                 break;
             case Password:
                 if( isalnum(ch) || ch == '%' )
                 {
-                    url.password += ch;
+                    // continue
                 }
                 else if( ch == '@' )
                 {
+                    setRange(result.password, start, i);
+                    start = i + 1;
                     state = Hostname;
                 }
                 else
                 {
-                    valid = false;
-                    url = Url();
+                    return invalid(result);
                 }
                 break;
             case Hostname:
-                if( ch == '[' && url.hostname.empty() )
+                if( ch == '[' && i == start )
                 {
+                    start = i + 1;
                     state = IPV6Hostname;
                 }
-                else if(isUnreserved(ch) || ch == '%')
+                else if( isUnreserved(ch) || ch == '%' )
                 {
-                    url.hostname += ch;
+                    // continue
                 }
-                else if(ch == ':')
+                else if( ch == ':' )
                 {
+                    setRange(result.hostname, start, i);
+                    start = i + 1;
                     state = Port;
                 }
-                else if(ch == '/')
+                else if( ch == '/' )
                 {
+                    setRange(result.hostname, start, i);
+                    start = i;
                     state = Path;
                 }
                 else
                 {
-                    valid = false;
-                    url = Url();
+                    return invalid(result);
                 }
                 break;
             case IPV6Hostname:
-                abort(); // TODO
+                if( isUnreserved(ch) || ch == ':' || ch == '%' )
+                {
+                    // continue
+                }
+                else if( ch == ']' && setIPv6Host(result, begin, start, i) )
+                {
+                    state = AfterIPV6Hostname;
+                }
+                else
+                {
+                    return invalid(result);
+                }
+                break;
+            case AfterIPV6Hostname:
+                if( ch == ':' )
+                {
+                    start = i + 1;
+                    state = Port;
+                }
+                else if( ch == '/' )
+                {
+                    start = i;
+                    state = Path;
+                }
+                else
+                {
+                    return invalid(result);
+                }
+                break;
             case PortOrPassword:
                 if( isdigit(ch) )
                 {
-                    portOrPassword += ch;
+                    // continue
                 }
                 else if( ch == '/' )
                 {
-                    std::swap(url.hostname, usernameOrHostname);
-                    std::swap(url.port, portOrPassword);
-                    url.integerPort = atoi(url.port.c_str());
+                    setRange(result.hostname, tokenStart, tokenEnd);
+                    setPort(result, begin, start, i);
+                    start = i;
                     state = Path;
                 }
                 else if( isalnum(ch) || ch == '%' )
                 {
-                    std::swap(url.username, usernameOrHostname);
-                    std::swap(url.password, portOrPassword);
-                    url.password += ch;
+                    setRange(result.username, tokenStart, tokenEnd);
                     state = Password;
                 }
                 else
                 {
-                    valid = false;
-                    url = Url();
+                    return invalid(result);
                 }
                 break;
             case Port:
                 if( isdigit(ch) )
                 {
-                    portOrPassword += ch;
+                    // continue
                 }
-                else if(ch == '/')
+                else if( ch == '/' )
                 {
-                    std::swap(url.port, portOrPassword);
-                    url.integerPort = atoi(url.port.c_str());
+                    setPort(result, begin, start, i);
+                    start = i;
                     state = Path;
                 }
                 else
                 {
-                    valid = false;
-                    url = Url();
+                    return invalid(result);
                 }
                 break;
             case Path:
-                if( ch == '#')
+                if( ch == '#' )
                 {
+                    setRange(result.path, start, i);
+                    start = i + 1;
                     state = Fragment;
                 }
                 else if( ch == '?' )
                 {
+                    setRange(result.path, start, i);
+                    start = i + 1;
                     state = Query;
                 }
-                else
-                {
-                    url.path += ch;
-                }
                 break;
             case Query:
-                if( ch == '#')
+                if( ch == '#' )
                 {
+                    setRange(result.query, start, i);
+                    start = i + 1;
                     state = Fragment;
                 }
-                else if( ch == '?' )
-                {
-                    state = Query;
-                }
-                else
-                {
-                    url.query += ch;
-                }
                 break;
             case Fragment:
-                url.fragment += ch;
                 break;
             }
         }
 
-        assert(portOrPassword.empty());
+        switch(state)
+        {
+        case Scheme:
+            setRange(result.scheme, 0, size);
+            break;
+        case UsernameOrHostname:
+            setRange(result.hostname, tokenStart, size);
+            break;
+        case PortOrPassword:
+            setRange(result.hostname, tokenStart, tokenEnd);
+            setPort(result, begin, start, size);
+            break;
+        case Password:
+            setRange(result.password, start, size);
+            break;
+        case Hostname:
+            setRange(result.hostname, start, size);
+            break;
+        case Port:
+            setPort(result, begin, start, size);
+            break;
+        case Path:
+            setRange(result.path, start, size);
+            break;
+        case Query:
+            setRange(result.query, start, size);
+            break;
+        case Fragment:
+            setRange(result.fragment, start, size);
+            break;
+        case IPV6Hostname:
+            return invalid(result);
+        default:
+            break;
+        }
+
+        if( result.hostType == HostName &&
+            parseIPv4(begin + result.hostname.offset,
+                      begin + result.hostname.offset + result.hostname.length,
+                      result.address.bytes) )
+        {
+            result.hostType = HostIPv4;
+        }
 
-        if( !usernameOrHostname.empty() )
-            url.hostname = usernameOrHostname;
+        return true;
     }
 
+    // Parse a dotted-decimal IPv4 address occupying all of [begin, end).
+    // Leading zeros are rejected as they are ambiguous (octal or decimal).
+    static bool parseIPv4(const char *begin, const char *end, uint8_t *out)
+    {
+        uint8_t bytes[4];
 
-    bool valid;
+        for(size_t part = 0; ; ++part)
+        {
+            const char *start = begin;
+            unsigned int value = 0;
+
+            while( begin != end && isDigit(*begin) )
+            {
+                value = value * 10 + (*begin++ - '0');
+
+                if( value > 255 )
+                    return false;
+            }
+
+            if( begin == start || (begin - start > 1 && *start == '0') )
+                return false;
+
+            bytes[part] = static_cast<uint8_t>(value);
+
+            if( part == 3 )
+            {
+                if( begin != end )
+                    return false;
 
-    struct Url
+                memcpy(out, bytes, sizeof(bytes));
+                return true;
+            }
+
+            if( begin == end || *begin != '.' )
+                return false;
+
+            ++begin;
+        }
+    }
+
+    // Parse an IPv6 address (RFC 4291 text form, including "::" and a
+    // trailing dotted IPv4 part) occupying all of [begin, end).
+    static bool parseIPv6(const char *begin, const char *end, uint8_t *out)
     {
-        Url() : integerPort(0)
-        {}
+        uint8_t bytes[16];
+        size_t size = 0;
+        int gap = -1;
 
-        std::string scheme;
-        std::string username;
-        std::string password;
-        std::string hostname;
-        std::string port;
-        std::string path;
-        std::string query;
-        std::string fragment;
-        uint16_t integerPort;
-    } url;
+        if( begin == end )
+            return false;
+
+        if( *begin == ':' )
+        {
+            if( end - begin < 2 || begin[1] != ':' )
+                return false;
+
+            begin += 2;
+            gap = 0;
+        }
+
+        while( begin != end )
+        {
+            const char *start = begin;
+            unsigned int value = 0;
+
+            while( begin != end && begin - start < 5 && isHexDigit(*begin) )
+                value = value * 16 + hexValue(*begin++);
+
+            if( begin == start || begin - start > 4 )
+                return false;
+
+            if( begin != end && *begin == '.' )
+            {
+                if( size > 12 || !parseIPv4(start, end, bytes + size) )
+                    return false;
+
+                size += 4;
+                break;
+            }
+
+            if( size == 16 )
+                return false;
+
+            bytes[size++] = static_cast<uint8_t>(value >> 8);
+            bytes[size++] = static_cast<uint8_t>(value);
+
+            if( begin == end )
+                break;
+
+            if( *begin++ != ':' || begin == end )
+                return false;
+
+            if( *begin == ':' )
+            {
+                if( gap >= 0 )
+                    return false;
+
+                gap = static_cast<int>(size);
+                ++begin;
+            }
+        }
+
+        if( gap >= 0 )
+        {
+            if( size == 16 )
+                return false;
+
+            size_t tail = size - gap;
+
+            memset(out, 0, 16);
+            memcpy(out, bytes, gap);
+            memcpy(out + 16 - tail, bytes + gap, tail);
+        }
+        else
+        {
+            if( size != 16 )
+                return false;
+
+            memcpy(out, bytes, 16);
+        }
+
+        return true;
+    }
+
+private:
+    static bool isUnreserved(char ch)
+    {
+        if( isalnum(ch) )
+            return true;
+
+        switch(ch)
+        {
+        case '-':
+        case '.':
+        case '_':
+        case '~':
+            return true;
+        }
+
+        return false;
+    }
+
+    static bool isDigit(char ch)
+    {
+        return ch >= '0' && ch <= '9';
+    }
+
+    static bool isHexDigit(char ch)
+    {
+        return isDigit(ch) || (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F');
+    }
+
+    static unsigned int hexValue(char ch)
+    {
+        if( isDigit(ch) )
+            return ch - '0';
+        else if( ch >= 'a' && ch <= 'f' )
+            return ch - 'a' + 10;
+        else
+            return ch - 'A' + 10;
+    }
+
+    // Decode the text between '[' and ']' at [from, to). A zone id is
+    // introduced by "%25" (RFC 6874) or by a bare '%' as used by inet_pton.
+    static bool setIPv6Host(Components &result, const char *text, uint32_t from, uint32_t to)
+    {
+        const char *pct = static_cast<const char *>(memchr(text + from, '%', to - from));
+        uint32_t addressEnd = pct ? static_cast<uint32_t>(pct - text) : to;
+
+        if( !parseIPv6(text + from, text + addressEnd, result.address.bytes) )
+            return false;
+
+        if( pct )
+        {
+            uint32_t zoneStart = addressEnd + 1;
+
+            if( to - zoneStart >= 2 && text[zoneStart] == '2' && text[zoneStart + 1] == '5' )
+                zoneStart += 2;
+
+            if( zoneStart == to )
+                return false;
+
+            setRange(result.zone, zoneStart, to);
+        }
+
+        setRange(result.hostname, from, addressEnd);
+        result.hostType = HostIPv6;
+        return true;
+    }
+
+    static void setRange(Range &range, uint32_t from, uint32_t to)
+    {
+        range.offset = from;
+        range.length = to - from;
+    }
+
+    static void setPort(Components &result, const char *text, uint32_t from, uint32_t to)
+    {
+        uint32_t value = 0;
+
+        for(uint32_t i = from; i < to; ++i)
+            value = value * 10 + (text[i] - '0');
+
+        setRange(result.port, from, to);
+        result.integerPort = static_cast<uint16_t>(value);
+    }
+
+    static bool invalid(Components &result)
+    {
+        result = Components();
+        return false;
+    }
+
+    std::string component(const Range &range) const
+    {
+        return source.substr(range.offset, range.length);
+    }
+
+    bool valid;
+    std::string source;
+    Components url;
 };
 
 } // namespace httpparser
@@ -0,0 +1,191 @@
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <httpparser/asyncread.h>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/write.hpp>
+
+#include <string>
+
+BOOST_AUTO_TEST_SUITE(AsyncReadTest)
+
+using httpparser::Request;
+using httpparser::Response;
+
+typedef boost::asio::local::stream_protocol::socket Socket;
+
+// Records the outcome of one read.
+struct Result
+{
+    Result() : called(false), bytes(0)
+    {}
+
+    void operator()(const boost::system::error_code &e, size_t n)
+    {
+        called = true;
+        ec = e;
+        bytes = n;
+    }
+
+    bool called;
+    boost::system::error_code ec;
+    size_t bytes;
+};
+
+struct Fixture
+{
+    Fixture() : server(io), client(io)
+    {
+        boost::asio::local::connect_pair(server, client);
+    }
+
+    void send(const std::string &text)
+    {
+        boost::asio::write(client, boost::asio::buffer(text));
+    }
+
+    boost::asio::io_context io;
+    Socket server;
+    Socket client;
+    boost::asio::streambuf buffer;
+};
+
+static const std::string getText =
+        "GET /first HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "\r\n";
+
+static const std::string postText =
+        "POST /second HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "Content-Length: 5\r\n"
+        "\r\n"
+        "hello";
+
+BOOST_FIXTURE_TEST_CASE(pipelined_requests_stay_in_the_buffer, Fixture)
+{
+    send(getText + postText + "GET /th");
+
+    Request req;
+    Result first;
+    httpparser::async_read_request(server, buffer, req, std::ref(first));
+    io.run();
+
+    BOOST_REQUIRE(first.called);
+    BOOST_CHECK(!first.ec);
+    BOOST_CHECK_EQUAL(first.bytes, getText.size());
+    BOOST_CHECK_EQUAL(req.uri, "/first");
+
+    // The second request is already buffered; it completes without a read
+    // but still through the io_context.
+    Result second;
+    httpparser::async_read_request(server, buffer, req, std::ref(second));
+    BOOST_CHECK(!second.called);
+
+    io.restart();
+    io.run();
+
+    BOOST_REQUIRE(second.called);
+    BOOST_CHECK(!second.ec);
+    BOOST_CHECK_EQUAL(second.bytes, postText.size());
+    BOOST_CHECK_EQUAL(req.method, "POST");
+    BOOST_CHECK_EQUAL(req.uri, "/second");
+    BOOST_CHECK_EQUAL(std::string(req.content.begin(), req.content.end()), "hello");
+    BOOST_CHECK_EQUAL(req.headers.size(), 2u);
+
+    // The third starts in the buffer and ends in later reads.
+    Result third;
+    httpparser::async_read_request(server, buffer, req, std::ref(third));
+    io.restart();
+    io.poll();
+    BOOST_CHECK(!third.called);
+
+    send("ird HTTP/1.1\r\n");
+    io.poll();
+    BOOST_CHECK(!third.called);
+
+    send("\r\n");
+    io.run();
+
+    BOOST_REQUIRE(third.called);
+    BOOST_CHECK(!third.ec);
+    BOOST_CHECK_EQUAL(req.uri, "/third");
+    BOOST_CHECK_EQUAL(buffer.size(), 0u);
+}
+
+BOOST_FIXTURE_TEST_CASE(response_with_body, Fixture)
+{
+    send("HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\nabcHTTP/1.1 204 No Content\r\n\r\n");
+
+    Response resp;
+    Result first;
+    httpparser::async_read_response(server, buffer, resp, std::ref(first));
+    io.run();
+
+    BOOST_REQUIRE(first.called);
+    BOOST_CHECK(!first.ec);
+    BOOST_CHECK_EQUAL(resp.statusCode, 200);
+    BOOST_CHECK_EQUAL(std::string(resp.content.begin(), resp.content.end()), "abc");
+
+    Result second;
+    httpparser::async_read_response(server, buffer, resp, std::ref(second));
+    io.restart();
+    io.run();
+
+    BOOST_REQUIRE(second.called);
+    BOOST_CHECK(!second.ec);
+    BOOST_CHECK_EQUAL(resp.statusCode, 204);
+    BOOST_CHECK(resp.content.empty());
+    BOOST_CHECK_EQUAL(resp.headers.size(), 0u);
+}
+
+BOOST_FIXTURE_TEST_CASE(malformed_request, Fixture)
+{
+    send("GET / HTTP/1.1\r\nBad Header\r\n\r\n");
+
+    Request req;
+    Result result;
+    httpparser::async_read_request(server, buffer, req, std::ref(result));
+    io.run();
+
+    BOOST_REQUIRE(result.called);
+    BOOST_CHECK(result.ec == boost::system::errc::bad_message);
+}
+
+BOOST_FIXTURE_TEST_CASE(eof_inside_request, Fixture)
+{
+    send("GET / HTTP/1.1\r\nHost:");
+    client.close();
+
+    Request req;
+    Result result;
+    httpparser::async_read_request(server, buffer, req, std::ref(result));
+    io.run();
+
+    BOOST_REQUIRE(result.called);
+    BOOST_CHECK(result.ec == boost::asio::error::eof);
+}
+
+BOOST_FIXTURE_TEST_CASE(buffer_limit, Fixture)
+{
+    boost::asio::streambuf small(64);
+    send("GET /" + std::string(100, 'a') + " HTTP/1.1\r\n\r\n");
+
+    Request req;
+    Result result;
+    httpparser::async_read_request(server, small, req, std::ref(result));
+    io.run();
+
+    // The parser uses every byte it is given, so the limit only bounds a
+    // single read, and the request still completes.
+    BOOST_REQUIRE(result.called);
+    BOOST_CHECK(!result.ec);
+    BOOST_CHECK_EQUAL(req.uri.size(), 101u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,191 @@
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <httpparser/batchparser.h>
+#include <httpparser/request.h>
+#include <httpparser/response.h>
+#include <httpparser/httprequestparser.h>
+#include <httpparser/httpresponseparser.h>
+
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(BatchParserTest)
+
+using httpparser::BatchParser;
+using httpparser::HttpRequestParser;
+using httpparser::HttpResponseParser;
+using httpparser::Request;
+using httpparser::Response;
+
+typedef BatchParser<HttpRequestParser, Request> RequestBatch;
+
+static const std::string getText =
+        "GET /first HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "\r\n";
+
+static const std::string postText =
+        "POST /second HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "Content-Length: 5\r\n"
+        "\r\n"
+        "hello";
+
+// Parser, message and input of one connection.
+struct Connection
+{
+    HttpRequestParser parser;
+    Request req;
+    std::string input;
+};
+
+static std::vector<RequestBatch::Job> makeJobs(std::vector<Connection> &connections)
+{
+    std::vector<RequestBatch::Job> jobs(connections.size());
+
+    for(size_t i = 0; i < connections.size(); ++i)
+    {
+        jobs[i].parser = &connections[i].parser;
+        jobs[i].message = &connections[i].req;
+        jobs[i].begin = connections[i].input.data();
+        jobs[i].end = jobs[i].begin + connections[i].input.size();
+    }
+
+    return jobs;
+}
+
+BOOST_AUTO_TEST_CASE(same_results_as_parsing_one_by_one)
+{
+    const std::string inputs[] = {
+        getText,
+        postText.substr(0, 30),
+        "GET / HTTP/1.1\r\nBad Header\r\n\r\n",
+        "",
+        postText + getText,
+        getText,
+        postText,
+        getText.substr(0, 5)
+    };
+    const size_t count = sizeof(inputs) / sizeof(inputs[0]);
+
+    std::vector<Connection> connections(count);
+
+    for(size_t i = 0; i < count; ++i)
+        connections[i].input = inputs[i];
+
+    std::vector<RequestBatch::Job> jobs = makeJobs(connections);
+    RequestBatch::parse(jobs);
+
+    for(size_t i = 0; i < count; ++i)
+    {
+        HttpRequestParser parser;
+        Request req;
+        HttpRequestParser::ParseResult expected = HttpRequestParser::ParsingIncompleted;
+        size_t consumed = 0;
+
+        if( !inputs[i].empty() )
+        {
+            expected = parser.parse(req, inputs[i].data(), inputs[i].data() + inputs[i].size());
+            consumed = parser.consumed();
+        }
+
+        BOOST_CHECK_EQUAL(jobs[i].result, expected);
+        BOOST_CHECK_EQUAL(static_cast<size_t>(jobs[i].begin - connections[i].input.data()), consumed);
+        BOOST_CHECK_EQUAL(connections[i].req.method, req.method);
+        BOOST_CHECK_EQUAL(connections[i].req.uri, req.uri);
+        BOOST_CHECK_EQUAL(connections[i].req.content.size(), req.content.size());
+    }
+
+    // The pipelined job stops after its first message.
+    BOOST_CHECK_EQUAL(jobs[4].result, HttpRequestParser::ParsingCompleted);
+    BOOST_CHECK_EQUAL(static_cast<size_t>(jobs[4].end - jobs[4].begin), getText.size());
+}
+
+BOOST_AUTO_TEST_CASE(rounds_interleave_pipelined_connections)
+{
+    // More connections than the prefetch distance, each with a different
+    // number of pipelined requests.
+    std::vector<Connection> connections(10);
+
+    for(size_t i = 0; i < connections.size(); ++i)
+    {
+        for(size_t k = 0; k <= i % 4; ++k)
+            connections[i].input += k % 2 ? postText : getText;
+    }
+
+    std::vector<RequestBatch::Job> jobs = makeJobs(connections);
+    std::vector<size_t> parsed(connections.size(), 0);
+    size_t rounds = 0;
+
+    while( !jobs.empty() )
+    {
+        RequestBatch::parse(jobs);
+        ++rounds;
+
+        std::vector<RequestBatch::Job> remaining;
+
+        for(size_t i = 0; i < jobs.size(); ++i)
+        {
+            BOOST_REQUIRE_EQUAL(jobs[i].result, HttpRequestParser::ParsingCompleted);
+
+            size_t index = 0;
+
+            while( &connections[index].parser != jobs[i].parser )
+                ++index;
+
+            BOOST_CHECK_EQUAL(jobs[i].message->method, parsed[index] % 2 ? "POST" : "GET");
+            ++parsed[index];
+
+            *jobs[i].parser = HttpRequestParser();
+            jobs[i].message->clear();
+
+            if( jobs[i].begin != jobs[i].end )
+                remaining.push_back(jobs[i]);
+        }
+
+        jobs.swap(remaining);
+    }
+
+    BOOST_CHECK_EQUAL(rounds, 4u);
+
+    for(size_t i = 0; i < connections.size(); ++i)
+        BOOST_CHECK_EQUAL(parsed[i], i % 4 + 1);
+}
+
+BOOST_AUTO_TEST_CASE(responses)
+{
+    typedef BatchParser<HttpResponseParser, Response> ResponseBatch;
+
+    const std::string texts[] = {
+        "HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\nabc",
+        "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n",
+        "HTTP/1.1 500 Internal"
+    };
+
+    HttpResponseParser parsers[3];
+    Response responses[3];
+    ResponseBatch::Job jobs[3];
+
+    for(size_t i = 0; i < 3; ++i)
+    {
+        jobs[i].parser = &parsers[i];
+        jobs[i].message = &responses[i];
+        jobs[i].begin = texts[i].data();
+        jobs[i].end = jobs[i].begin + texts[i].size();
+    }
+
+    ResponseBatch::parse(jobs, 3);
+
+    BOOST_CHECK_EQUAL(jobs[0].result, HttpResponseParser::ParsingCompleted);
+    BOOST_CHECK_EQUAL(responses[0].statusCode, 200);
+    BOOST_CHECK_EQUAL(std::string(responses[0].content.begin(), responses[0].content.end()), "abc");
+    BOOST_CHECK_EQUAL(jobs[1].result, HttpResponseParser::ParsingCompleted);
+    BOOST_CHECK_EQUAL(responses[1].statusCode, 404);
+    BOOST_CHECK_EQUAL(jobs[2].result, HttpResponseParser::ParsingIncompleted);
+    BOOST_CHECK(jobs[2].begin == jobs[2].end);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,118 @@
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+#include <httpparser/chunkeddecoder.h>
+
+BOOST_AUTO_TEST_SUITE(ChunkedDecoderTest)
+
+using httpparser::ChunkedDecoder;
+
+static const char body[] = "23\r\n"
+                           "This is the data in the first chunk\r\n"
+                           "1A; name=value\r\n"
+                           "and this is the second one\r\n"
+                           "3\r\n"
+                           "con\r\n"
+                           "8\r\n"
+                           "sequence\r\n"
+                           "0\r\n"
+                           "Trailer-Name: value\r\n"
+                           "\r\n";
+
+static const char decoded[] = "This is the data in the first chunk"
+                              "and this is the second one"
+                              "consequence";
+
+BOOST_AUTO_TEST_CASE(decode_whole_body)
+{
+    std::vector<char> buffer(body, body + sizeof(body) - 1);
+    size_t size = buffer.size();
+
+    ChunkedDecoder decoder;
+
+    BOOST_REQUIRE_EQUAL(decoder.decode(&buffer[0], size), ChunkedDecoder::ParsingCompleted);
+    BOOST_CHECK_EQUAL(std::string(&buffer[0], size), decoded);
+    BOOST_CHECK_EQUAL(decoder.leftover(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(decode_byte_by_byte)
+{
+    // Emulate a connection buffer: decoded payload stays at the front and
+    // every newly received byte is appended right after it.
+    std::vector<char> buffer(sizeof(body));
+    size_t decodedSize = 0;
+
+    ChunkedDecoder decoder;
+    ChunkedDecoder::ParseResult result = ChunkedDecoder::ParsingIncompleted;
+
+    for(size_t i = 0; i < sizeof(body) - 1; ++i)
+    {
+        BOOST_REQUIRE_EQUAL(result, ChunkedDecoder::ParsingIncompleted);
+
+        buffer[decodedSize] = body[i];
+        size_t size = 1;
+        result = decoder.decode(&buffer[decodedSize], size);
+
+        BOOST_REQUIRE(result != ChunkedDecoder::ParsingError);
+        decodedSize += size;
+    }
+
+    BOOST_CHECK_EQUAL(result, ChunkedDecoder::ParsingCompleted);
+    BOOST_CHECK_EQUAL(std::string(&buffer[0], decodedSize), decoded);
+}
+
+BOOST_AUTO_TEST_CASE(keep_pipelined_bytes)
+{
+    std::string text = std::string("5\r\nhello\r\n0\r\n\r\n") + "GET / HTTP/1.1\r\n\r\n";
+    std::vector<char> buffer(text.begin(), text.end());
+    size_t size = buffer.size();
+
+    ChunkedDecoder decoder;
+
+    BOOST_REQUIRE_EQUAL(decoder.decode(&buffer[0], size), ChunkedDecoder::ParsingCompleted);
+    BOOST_CHECK_EQUAL(std::string(&buffer[0], size), "hello");
+    BOOST_CHECK_EQUAL(std::string(&buffer[size], decoder.leftover()), "GET / HTTP/1.1\r\n\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(reject_bad_framing)
+{
+    const char *bodies[] = {
+        "zz\r\nhello\r\n0\r\n\r\n",
+        "\r\nhello\r\n0\r\n\r\n",
+        "5\r\nhelloXX0\r\n\r\n",
+        "5\nhello\r\n0\r\n\r\n",
+        "FFFFFFFFFFFFFFFFF\r\n"
+    };
+
+    for(size_t i = 0; i < sizeof(bodies) / sizeof(bodies[0]); ++i)
+    {
+        std::string text = bodies[i];
+        size_t size = text.size();
+
+        ChunkedDecoder decoder;
+        BOOST_CHECK_EQUAL(decoder.decode(&text[0], size), ChunkedDecoder::ParsingError);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(reset_for_next_body)
+{
+    ChunkedDecoder decoder;
+
+    std::string first = "3\r\nabc\r\n0\r\n\r\n";
+    size_t size = first.size();
+    BOOST_REQUIRE_EQUAL(decoder.decode(&first[0], size), ChunkedDecoder::ParsingCompleted);
+
+    decoder.reset();
+
+    std::string second = "2\r\nde\r\n0\r\n\r\n";
+    size = second.size();
+    BOOST_REQUIRE_EQUAL(decoder.decode(&second[0], size), ChunkedDecoder::ParsingCompleted);
+    BOOST_CHECK_EQUAL(second.substr(0, size), "de");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,113 @@
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <httpparser/response.h>
+#include <httpparser/httpresponseparser.h>
+#include <httpparser/httpserializer.h>
+#include <httpparser/chunkedencoder.h>
+
+#include "common.h"
+
+BOOST_AUTO_TEST_SUITE(ChunkedEncoderTest)
+
+using httpparser::ChunkedEncoder;
+using httpparser::HttpResponseParser;
+using httpparser::HttpSerializer;
+using httpparser::Response;
+
+static std::string join(const struct iovec *iov, size_t count)
+{
+    std::string result;
+
+    for(size_t i = 0; i < count; ++i)
+        result.append(static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE(size_line)
+{
+    char line[ChunkedEncoder::maxSizeLineSize];
+
+    BOOST_CHECK_EQUAL(std::string(line, ChunkedEncoder::sizeLine(0, line)), "0\r\n");
+    BOOST_CHECK_EQUAL(std::string(line, ChunkedEncoder::sizeLine(9, line)), "9\r\n");
+    BOOST_CHECK_EQUAL(std::string(line, ChunkedEncoder::sizeLine(0x23, line)), "23\r\n");
+    BOOST_CHECK_EQUAL(std::string(line, ChunkedEncoder::sizeLine(0xABCDEF, line)), "ABCDEF\r\n");
+    BOOST_CHECK_EQUAL(std::string(line, ChunkedEncoder::sizeLine(static_cast<size_t>(-1), line)),
+                      std::string(sizeof(size_t) * 2, 'F') + "\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(gather_chunk_references_payload)
+{
+    const char payload[] = "This is the data in the first chunk";
+    char line[ChunkedEncoder::maxSizeLineSize];
+    struct iovec iov[ChunkedEncoder::chunkIovecCount];
+
+    BOOST_REQUIRE_EQUAL(ChunkedEncoder::gatherChunk(payload, sizeof(payload) - 1, line, iov), 3);
+    BOOST_CHECK(iov[1].iov_base == payload);
+    BOOST_CHECK_EQUAL(join(iov, 3), "23\r\nThis is the data in the first chunk\r\n");
+
+    BOOST_CHECK_EQUAL(ChunkedEncoder::gatherChunk(payload, 0, line, iov), 0);
+}
+
+BOOST_AUTO_TEST_CASE(streamed_response_round_trip)
+{
+    Response head = ResponseDsl()
+            .statusCode(200)
+            .status("OK")
+            .version(1, 1)
+            .header("Transfer-Encoding", "chunked");
+
+    std::vector<Response::HeaderItem> trailers;
+    Response::HeaderItem trailer = { "Checksum", "abc" };
+    trailers.push_back(trailer);
+
+    const char *parts[] = { "first part, ", "second part, ", "", "last part" };
+    char lines[4][ChunkedEncoder::maxSizeLineSize];
+
+    HttpSerializer serializer;
+    std::vector<struct iovec> iov(HttpSerializer::iovecCount(head) + 4 * 3
+                                  + ChunkedEncoder::lastChunkIovecCount(trailers));
+
+    size_t count = serializer.gather(head, &iov[0], iov.size());
+
+    for(size_t i = 0; i < 4; ++i)
+        count += ChunkedEncoder::gatherChunk(parts[i], strlen(parts[i]), lines[i], &iov[count]);
+
+    count += ChunkedEncoder::gatherLastChunk(trailers, &iov[count], iov.size() - count);
+
+    std::string text = join(&iov[0], count);
+
+    std::vector<char> buffer;
+    HttpSerializer::serialize(head, buffer);
+
+    for(size_t i = 0; i < 4; ++i)
+        ChunkedEncoder::appendChunk(buffer, parts[i], strlen(parts[i]));
+
+    ChunkedEncoder::appendLastChunk(buffer, trailers);
+
+    BOOST_CHECK_EQUAL(std::string(buffer.begin(), buffer.end()), text);
+
+    Response response;
+    HttpResponseParser parser;
+
+    BOOST_REQUIRE_EQUAL(parser.parse(response, text.data(), text.data() + text.size()),
+                        HttpResponseParser::ParsingCompleted);
+    BOOST_CHECK_EQUAL(std::string(response.content.begin(), response.content.end()),
+                      "first part, second part, last part");
+}
+
+BOOST_AUTO_TEST_CASE(last_chunk_without_trailers)
+{
+    std::vector<char> buffer;
+    ChunkedEncoder::appendLastChunk(buffer);
+    BOOST_CHECK_EQUAL(std::string(buffer.begin(), buffer.end()), "0\r\n\r\n");
+
+    struct iovec iov[1];
+    BOOST_CHECK_EQUAL(ChunkedEncoder::gatherLastChunk(iov), 1);
+    BOOST_CHECK_EQUAL(join(iov, 1), "0\r\n\r\n");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
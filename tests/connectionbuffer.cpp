@@ -0,0 +1,169 @@
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <httpparser/connectionbuffer.h>
+#include <httpparser/request.h>
+#include <httpparser/httprequestparser.h>
+
+#include <algorithm>
+#include <string>
+
+#include <string.h>
+
+BOOST_AUTO_TEST_SUITE(ConnectionBufferTest)
+
+using httpparser::ConnectionBuffer;
+using httpparser::HttpRequestParser;
+using httpparser::Request;
+
+// Copy as much of `text` from `offset` as prepare() makes room for, up to
+// `chunk` bytes, like a read() would.
+static size_t receive(ConnectionBuffer &buffer, const std::string &text, size_t offset, size_t chunk)
+{
+    size_t room = buffer.prepare();
+    size_t n = std::min(std::min(room, chunk), text.size() - offset);
+
+    memcpy(buffer.writeBegin(), text.data() + offset, n);
+    buffer.commit(n);
+    return n;
+}
+
+static ConnectionBuffer::Limits makeLimits(size_t initialCapacity, size_t maxCapacity, size_t minRead)
+{
+    ConnectionBuffer::Limits limits;
+    limits.initialCapacity = initialCapacity;
+    limits.maxCapacity = maxCapacity;
+    limits.minRead = minRead;
+    return limits;
+}
+
+static const std::string getText =
+        "GET /first HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "\r\n";
+
+static const std::string postText =
+        "POST /second HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "Content-Length: 5\r\n"
+        "\r\n"
+        "hello";
+
+BOOST_AUTO_TEST_CASE(allocates_on_first_prepare)
+{
+    ConnectionBuffer buffer;
+
+    BOOST_CHECK_EQUAL(buffer.capacity(), 0u);
+    BOOST_CHECK(buffer.empty());
+
+    BOOST_CHECK_EQUAL(buffer.prepare(), 4096u);
+    BOOST_CHECK_EQUAL(buffer.capacity(), 4096u);
+}
+
+BOOST_AUTO_TEST_CASE(leftover_bytes_wait_for_the_next_round)
+{
+    // Waiting for whole heads, the parser leaves partial ones in the
+    // buffer; reads of 7 bytes make every message span several rounds.
+    std::string text;
+
+    for(int i = 0; i < 20; ++i)
+        text += i % 2 ? postText : getText;
+
+    ConnectionBuffer buffer(makeLimits(64, 1024, 16));
+    HttpRequestParser parser;
+    parser.setWaitForHead(true);
+    Request req;
+
+    size_t offset = 0;
+    size_t completed = 0;
+
+    while( offset < text.size() )
+    {
+        offset += receive(buffer, text, offset, 7);
+
+        while( !buffer.empty() )
+        {
+            HttpRequestParser::ParseResult res = buffer.parse(parser, req);
+
+            if( res == HttpRequestParser::ParsingIncompleted || parser.consumed() == 0 )
+                break;
+
+            BOOST_REQUIRE_EQUAL(res, HttpRequestParser::ParsingCompleted);
+            BOOST_CHECK_EQUAL(req.uri, completed % 2 ? "/second" : "/first");
+            ++completed;
+
+            req.clear();
+            parser = HttpRequestParser();
+            parser.setWaitForHead(true);
+        }
+    }
+
+    BOOST_CHECK_EQUAL(completed, 20u);
+    BOOST_CHECK(buffer.empty());
+    BOOST_CHECK_EQUAL(buffer.capacity(), 64u);
+}
+
+BOOST_AUTO_TEST_CASE(compacts_only_when_needed)
+{
+    ConnectionBuffer buffer(makeLimits(64, 64, 16));
+    std::string text(40, 'x');
+
+    receive(buffer, text, 0, 40);
+    buffer.consume(30);
+
+    // 24 bytes are free behind the pending ones: enough, nothing moves.
+    const char *pending = buffer.begin();
+    BOOST_CHECK_EQUAL(buffer.prepare(), 24u);
+    BOOST_CHECK(buffer.begin() == pending);
+
+    std::string more(20, 'y');
+    receive(buffer, more, 0, 20);
+
+    // Only 4 are free now; the 30 pending bytes move to the front.
+    BOOST_CHECK_EQUAL(buffer.prepare(), 34u);
+    BOOST_CHECK_EQUAL(buffer.size(), 30u);
+    BOOST_CHECK_EQUAL(std::string(buffer.begin(), buffer.end()), std::string(10, 'x') + more);
+}
+
+BOOST_AUTO_TEST_CASE(grows_to_the_limit_and_shrinks_back)
+{
+    ConnectionBuffer buffer(makeLimits(64, 256, 16));
+    std::string text(300, 'z');
+    size_t offset = 0;
+
+    while( buffer.prepare() > 0 )
+        offset += receive(buffer, text, offset, 1000);
+
+    // Full of unparsed input at the high watermark.
+    BOOST_CHECK_EQUAL(buffer.capacity(), 256u);
+    BOOST_CHECK_EQUAL(buffer.size(), 256u);
+    BOOST_CHECK_EQUAL(offset, 256u);
+
+    buffer.consume(200);
+    BOOST_CHECK_EQUAL(buffer.capacity(), 256u);
+
+    buffer.consume(56);
+    BOOST_CHECK(buffer.empty());
+    BOOST_CHECK_EQUAL(buffer.capacity(), 64u);
+}
+
+BOOST_AUTO_TEST_CASE(clear_drops_pending_bytes)
+{
+    ConnectionBuffer buffer(makeLimits(16, 128, 8));
+    std::string text(100, 'a');
+
+    size_t offset = 0;
+
+    while( offset < text.size() )
+        offset += receive(buffer, text, offset, 100);
+
+    BOOST_CHECK(buffer.capacity() > 16u);
+
+    buffer.clear();
+    BOOST_CHECK(buffer.empty());
+    BOOST_CHECK_EQUAL(buffer.capacity(), 16u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,294 @@
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <httpparser/coroutinereader.h>
+
+#include <string>
+#include <vector>
+
+#include <string.h>
+
+BOOST_AUTO_TEST_SUITE(CoroutineReaderTest)
+
+using httpparser::HttpRequestParser;
+using httpparser::HttpResponseParser;
+using httpparser::Request;
+using httpparser::RequestReader;
+using httpparser::Response;
+using httpparser::ResponseReader;
+
+// A byte source fed by the test. A read suspends until push() or close().
+class TestSource
+{
+public:
+    TestSource() : pending(NULL), pendingSize(0), closed(false)
+    {}
+
+    struct ReadSome
+    {
+        bool await_ready() const
+        {
+            return source.pendingSize > 0 || source.closed;
+        }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            source.waiting = h;
+        }
+
+        size_t await_resume()
+        {
+            size_t n = source.pendingSize < size ? source.pendingSize : size;
+            memcpy(data, source.pending, n);
+            source.pending += n;
+            source.pendingSize -= n;
+            return n;
+        }
+
+        TestSource &source;
+        char *data;
+        size_t size;
+    };
+
+    ReadSome read_some(char *data, size_t size)
+    {
+        return ReadSome{*this, data, size};
+    }
+
+    // Make `text` readable and run the reader until it waits again.
+    void push(const std::string &text)
+    {
+        pending = text.data();
+        pendingSize = text.size();
+        wake();
+    }
+
+    void close()
+    {
+        closed = true;
+        wake();
+    }
+
+private:
+    void wake()
+    {
+        while( waiting && (pendingSize > 0 || closed) )
+        {
+            std::coroutine_handle<> h = waiting;
+            waiting = nullptr;
+            h.resume();
+        }
+    }
+
+    const char *pending;
+    size_t pendingSize;
+    bool closed;
+    std::coroutine_handle<> waiting;
+};
+
+// Fire-and-forget coroutine for the test drivers.
+struct Detached
+{
+    struct promise_type
+    {
+        Detached get_return_object()
+        {
+            return Detached();
+        }
+
+        std::suspend_never initial_suspend() noexcept
+        {
+            return std::suspend_never();
+        }
+
+        std::suspend_never final_suspend() noexcept
+        {
+            return std::suspend_never();
+        }
+
+        void return_void()
+        {}
+
+        void unhandled_exception()
+        {
+            std::terminate();
+        }
+    };
+};
+
+struct Log
+{
+    Log() : requests(0), result(HttpRequestParser::ParsingCompleted), done(false)
+    {}
+
+    size_t requests;
+    std::string lastUri;
+    std::string lastContent;
+    HttpRequestParser::ParseResult result;
+    bool done;
+};
+
+template <typename Reader>
+static Detached serve(Reader &reader, Request &req, Log &log)
+{
+    for(;;)
+    {
+        HttpRequestParser::ParseResult res = co_await reader.next_request(req);
+
+        if( res != HttpRequestParser::ParsingCompleted )
+        {
+            log.result = res;
+            log.done = true;
+            co_return;
+        }
+
+        ++log.requests;
+        log.lastUri = req.uri;
+        log.lastContent.assign(req.content.begin(), req.content.end());
+    }
+}
+
+static const std::string getText =
+        "GET /first HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "\r\n";
+
+static const std::string postText =
+        "POST /second HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "Content-Length: 5\r\n"
+        "\r\n"
+        "hello";
+
+BOOST_AUTO_TEST_CASE(suspends_until_a_message_is_complete)
+{
+    TestSource source;
+    RequestReader<TestSource> reader(source);
+    Request req;
+    Log log;
+
+    serve(reader, req, log);
+    BOOST_CHECK_EQUAL(log.requests, 0u);
+
+    source.push(getText.substr(0, 10));
+    BOOST_CHECK_EQUAL(log.requests, 0u);
+
+    source.push(getText.substr(10) + postText.substr(0, 30));
+    BOOST_CHECK_EQUAL(log.requests, 1u);
+    BOOST_CHECK_EQUAL(log.lastUri, "/first");
+
+    source.push(postText.substr(30));
+    BOOST_CHECK_EQUAL(log.requests, 2u);
+    BOOST_CHECK_EQUAL(log.lastUri, "/second");
+    BOOST_CHECK_EQUAL(log.lastContent, "hello");
+
+    BOOST_CHECK(!log.done);
+    source.close();
+    BOOST_CHECK(log.done);
+    BOOST_CHECK_EQUAL(log.result, HttpRequestParser::ParsingIncompleted);
+}
+
+BOOST_AUTO_TEST_CASE(pipelined_requests_in_one_read)
+{
+    TestSource source;
+    RequestReader<TestSource> reader(source);
+    Request req;
+    Log log;
+
+    serve(reader, req, log);
+    source.push(getText + postText + getText);
+
+    BOOST_CHECK_EQUAL(log.requests, 3u);
+    BOOST_CHECK_EQUAL(log.lastUri, "/first");
+    BOOST_CHECK_EQUAL(reader.buffered(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(message_larger_than_the_buffer)
+{
+    TestSource source;
+    RequestReader<TestSource, 16> reader(source);
+    Request req;
+    Log log;
+
+    serve(reader, req, log);
+    source.push(postText + getText);
+
+    BOOST_CHECK_EQUAL(log.requests, 2u);
+    BOOST_CHECK_EQUAL(log.lastUri, "/first");
+}
+
+BOOST_AUTO_TEST_CASE(malformed_request)
+{
+    TestSource source;
+    RequestReader<TestSource> reader(source);
+    Request req;
+    Log log;
+
+    serve(reader, req, log);
+    source.push(getText + "GET / HTTP/1.1\r\nBad Header\r\n\r\n");
+
+    BOOST_CHECK_EQUAL(log.requests, 1u);
+    BOOST_CHECK(log.done);
+    BOOST_CHECK_EQUAL(log.result, HttpRequestParser::ParsingError);
+}
+
+BOOST_AUTO_TEST_CASE(frames_stay_in_the_arena)
+{
+    TestSource source;
+    RequestReader<TestSource> reader(source);
+    Request req;
+    Log log;
+
+    serve(reader, req, log);
+
+    source.push(postText);
+
+    std::string batch;
+
+    for(int i = 0; i < 10; ++i)
+        batch += getText + postText;
+
+    std::vector<std::string> pieces;
+
+    for(size_t i = 0; i < batch.size(); i += 7)
+        pieces.push_back(batch.substr(i, 7));
+
+    for(size_t i = 0; i < pieces.size(); ++i)
+        source.push(pieces[i]);
+
+    // Every frame came from the reader's arena.
+    BOOST_CHECK_EQUAL(reader.frameArena().heapAllocations(), 0u);
+    BOOST_CHECK_EQUAL(log.requests, 21u);
+    BOOST_CHECK(!log.done);
+}
+
+static Detached readResponses(ResponseReader<TestSource> &reader, Response &resp, std::string &codes)
+{
+    for(;;)
+    {
+        HttpResponseParser::ParseResult res = co_await reader.next_response(resp);
+
+        if( res != HttpResponseParser::ParsingCompleted )
+            co_return;
+
+        codes += std::to_string(resp.statusCode) + " ";
+    }
+}
+
+BOOST_AUTO_TEST_CASE(responses)
+{
+    TestSource source;
+    ResponseReader<TestSource> reader(source);
+    Response resp;
+    std::string codes;
+
+    readResponses(reader, resp, codes);
+    source.push("HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\nabcHTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+
+    BOOST_CHECK_EQUAL(codes, "200 404 ");
+    BOOST_CHECK(resp.content.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,108 @@
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <httpparser/request.h>
+#include <httpparser/response.h>
+#include <httpparser/httprequestparser.h>
+#include <httpparser/httpresponseparser.h>
+
+BOOST_AUTO_TEST_SUITE(DiscardBody)
+
+using httpparser::HttpRequestParser;
+using httpparser::HttpResponseParser;
+using httpparser::Request;
+using httpparser::Response;
+
+static const std::string chunkedRequest =
+        "POST /upload HTTP/1.1\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "23\r\n"
+        "This is the data in the first chunk\r\n"
+        "1a; name=value\r\n"
+        "and this is the second one\r\n"
+        "0\r\n"
+        "X-Checksum: 0a-1b\r\n"
+        "Expires: Wed, 21 Oct 2015 07:28:00 GMT\r\n"
+        "\r\n";
+
+BOOST_AUTO_TEST_CASE(discard_content_length_body)
+{
+    const std::string text = "POST /upload HTTP/1.1\r\n"
+                             "Content-Length: 11\r\n"
+                             "\r\n"
+                             "hello world"
+                             "GET /next HTTP/1.1\r\n\r\n";
+
+    Request request;
+    HttpRequestParser parser;
+    parser.setDiscardBody(true);
+
+    BOOST_REQUIRE_EQUAL(parser.parse(request, text.data(), text.data() + text.size()),
+                        HttpRequestParser::ParsingCompleted);
+    BOOST_CHECK(request.content.empty());
+    BOOST_CHECK_EQUAL(text.substr(parser.consumed()), "GET /next HTTP/1.1\r\n\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(discard_chunked_body_with_trailers)
+{
+    Request request;
+    HttpRequestParser parser;
+    parser.setDiscardBody(true);
+
+    BOOST_REQUIRE_EQUAL(parser.parse(request, chunkedRequest.data(), chunkedRequest.data() + chunkedRequest.size()),
+                        HttpRequestParser::ParsingCompleted);
+    BOOST_CHECK(request.content.empty());
+    BOOST_CHECK_EQUAL(parser.consumed(), chunkedRequest.size());
+}
+
+BOOST_AUTO_TEST_CASE(store_chunked_body_fed_in_pieces)
+{
+    for(size_t step = 1; step < 16; ++step)
+    {
+        Request request;
+        HttpRequestParser parser;
+        HttpRequestParser::ParseResult result = HttpRequestParser::ParsingIncompleted;
+
+        for(size_t i = 0; i < chunkedRequest.size(); i += step)
+        {
+            BOOST_REQUIRE_EQUAL(result, HttpRequestParser::ParsingIncompleted);
+
+            const char *begin = chunkedRequest.data() + i;
+            const char *end = chunkedRequest.data() + std::min(chunkedRequest.size(), i + step);
+            result = parser.parse(request, begin, end);
+        }
+
+        BOOST_REQUIRE_EQUAL(result, HttpRequestParser::ParsingCompleted);
+        BOOST_CHECK_EQUAL(std::string(request.content.begin(), request.content.end()),
+                          "This is the data in the first chunk"
+                          "and this is the second one");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(discard_response_body_fed_in_pieces)
+{
+    const std::string text = "HTTP/1.1 200 OK\r\n"
+                             "Content-Length: 26\r\n"
+                             "\r\n"
+                             "abcdefghijklmnopqrstuvwxyz";
+
+    Response response;
+    HttpResponseParser parser;
+    parser.setDiscardBody(true);
+
+    HttpResponseParser::ParseResult result = HttpResponseParser::ParsingIncompleted;
+
+    for(size_t i = 0; i < text.size(); i += 7)
+    {
+        BOOST_REQUIRE_EQUAL(result, HttpResponseParser::ParsingIncompleted);
+        result = parser.parse(response, text.data() + i, text.data() + std::min(text.size(), i + 7));
+    }
+
+    BOOST_CHECK_EQUAL(result, HttpResponseParser::ParsingCompleted);
+    BOOST_CHECK(response.content.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
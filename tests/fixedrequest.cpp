@@ -0,0 +1,229 @@
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <httpparser/fixedrequest.h>
+#include <httpparser/fixedrequestparser.h>
+#include <httpparser/httprequestparser.h>
+#include <httpparser/request.h>
+
+#include <new>
+#include <stdlib.h>
+
+// Count allocations made through operator new while `counting` is set.
+static bool counting = false;
+static size_t allocations = 0;
+
+void *operator new(size_t size)
+{
+    if( counting )
+        ++allocations;
+
+    void *p = malloc(size ? size : 1);
+
+    if( p == NULL )
+        throw std::bad_alloc();
+
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+BOOST_AUTO_TEST_SUITE(FixedRequestTest)
+
+using httpparser::FixedRequest;
+using httpparser::FixedRequestParser;
+using httpparser::HttpRequestParser;
+using httpparser::Request;
+
+typedef FixedRequest<8, 256> SmallRequest;
+
+static const std::string requestText =
+        "POST /upload?id=1 HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "Content-Length: 5\r\n"
+        "Connection: close\r\n"
+        "\r\n"
+        "hello";
+
+BOOST_AUTO_TEST_CASE(parse_without_allocating)
+{
+    SmallRequest request;
+    FixedRequestParser parser;
+
+    allocations = 0;
+    counting = true;
+    FixedRequestParser::ParseResult res = parser.parse(request, requestText.data(), requestText.data() + requestText.size());
+    counting = false;
+
+    BOOST_CHECK_EQUAL(allocations, 0);
+    BOOST_REQUIRE_EQUAL(res, FixedRequestParser::HeadersCompleted);
+    BOOST_CHECK(request.method() == "POST");
+    BOOST_CHECK(request.uri() == "/upload?id=1");
+    BOOST_CHECK_EQUAL(request.versionMajor, 1);
+    BOOST_CHECK_EQUAL(request.versionMinor, 1);
+    BOOST_CHECK_EQUAL(request.headerCount, 3);
+    BOOST_CHECK(request.headerName(1) == "Content-Length");
+    BOOST_CHECK(request.header("host") == "example.com");
+    BOOST_CHECK(request.header("Accept").data == NULL);
+    BOOST_CHECK(!request.keepAlive);
+    BOOST_CHECK_EQUAL(parser.contentLength(), 5);
+    BOOST_CHECK_EQUAL(requestText.substr(parser.consumed()), "hello");
+}
+
+BOOST_AUTO_TEST_CASE(parse_split_input)
+{
+    const std::string text = "GET / HTTP/1.1\r\nHost: a\r\n\r\nGET /next HTTP/1.1\r\n\r\n";
+
+    SmallRequest request;
+    FixedRequestParser parser;
+    FixedRequestParser::ParseResult res = FixedRequestParser::ParsingIncompleted;
+    size_t pos = 0;
+
+    while( res == FixedRequestParser::ParsingIncompleted )
+    {
+        res = parser.parse(request, text.data() + pos, text.data() + std::min(pos + 3, text.size()));
+        pos += parser.consumed();
+    }
+
+    BOOST_CHECK_EQUAL(res, FixedRequestParser::ParsingCompleted);
+    BOOST_CHECK_EQUAL(text.substr(pos), "GET /next HTTP/1.1\r\n\r\n");
+    BOOST_CHECK(request.keepAlive);
+    BOOST_CHECK(request.uri() == "/");
+}
+
+BOOST_AUTO_TEST_CASE(limits)
+{
+    std::string longHead = "GET /" + std::string(300, 'a') + " HTTP/1.1\r\n\r\n";
+
+    SmallRequest request;
+    FixedRequestParser parser;
+
+    BOOST_CHECK_EQUAL(parser.parse(request, longHead.data(), longHead.data() + longHead.size()),
+                      FixedRequestParser::ParsingLimitExceeded);
+
+    std::string manyHeaders = "GET / HTTP/1.1\r\n";
+
+    for(size_t i = 0; i < 9; ++i)
+        manyHeaders += "X: y\r\n";
+
+    manyHeaders += "\r\n";
+
+    SmallRequest other;
+    FixedRequestParser otherParser;
+
+    BOOST_CHECK_EQUAL(otherParser.parse(other, manyHeaders.data(), manyHeaders.data() + manyHeaders.size()),
+                      FixedRequestParser::ParsingLimitExceeded);
+}
+
+BOOST_AUTO_TEST_CASE(errors)
+{
+    const char *invalid[] = {
+        "GET /index.html\r\n\r\n",
+        "GET / HTTP/1.1\r\nX-Folded: a\r\n b\r\n\r\n",
+        "GET / HTTP/1.1\r\nHost:a\r\n\r\n",
+        "POST / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n",
+        "OPTIONS *x HTTP/1.1\r\n\r\n",
+        "G(T / HTTP/1.1\r\n\r\n"
+    };
+
+    for(size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i)
+    {
+        const std::string text = invalid[i];
+
+        SmallRequest request;
+        FixedRequestParser parser;
+
+        BOOST_CHECK_EQUAL(parser.parse(request, text.data(), text.data() + text.size()),
+                          FixedRequestParser::ParsingError);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(same_rules_as_request_parser)
+{
+    // A target without a scheme is none of the request-target forms.
+    const std::string relative = "GET foo/x HTTP/1.1\r\n\r\n";
+
+    // Content-Length may be surrounded by spaces.
+    const std::string spaces =
+            "POST / HTTP/1.1\r\n"
+            "Content-Length:  3 \r\n"
+            "\r\n"
+            "abc";
+
+    // The first Connection header decides.
+    const std::string connection =
+            "GET / HTTP/1.1\r\n"
+            "Connection: close\r\n"
+            "Connection: keep-alive\r\n"
+            "\r\n";
+
+    {
+        SmallRequest fixed;
+        FixedRequestParser fixedParser;
+        Request req;
+        HttpRequestParser parser;
+
+        BOOST_CHECK_EQUAL(fixedParser.parse(fixed, relative.data(), relative.data() + relative.size()),
+                          FixedRequestParser::ParsingError);
+        BOOST_CHECK_EQUAL(parser.parse(req, relative.data(), relative.data() + relative.size()),
+                          HttpRequestParser::ParsingError);
+    }
+
+    {
+        SmallRequest fixed;
+        FixedRequestParser fixedParser;
+        Request req;
+        HttpRequestParser parser;
+
+        BOOST_CHECK_EQUAL(fixedParser.parse(fixed, spaces.data(), spaces.data() + spaces.size()),
+                          FixedRequestParser::HeadersCompleted);
+        BOOST_CHECK_EQUAL(fixedParser.contentLength(), 3u);
+        BOOST_CHECK_EQUAL(parser.parse(req, spaces.data(), spaces.data() + spaces.size()),
+                          HttpRequestParser::ParsingCompleted);
+        BOOST_CHECK_EQUAL(req.content.size(), 3u);
+    }
+
+    {
+        SmallRequest fixed;
+        FixedRequestParser fixedParser;
+        Request req;
+        HttpRequestParser parser;
+
+        BOOST_CHECK_EQUAL(fixedParser.parse(fixed, connection.data(), connection.data() + connection.size()),
+                          FixedRequestParser::ParsingCompleted);
+        BOOST_CHECK_EQUAL(parser.parse(req, connection.data(), connection.data() + connection.size()),
+                          HttpRequestParser::ParsingCompleted);
+        BOOST_CHECK(!fixed.keepAlive);
+        BOOST_CHECK(!req.keepAlive);
+    }
+
+    // The other forms are still accepted.
+    const char *valid[] = {
+        "GET http://example.com/ HTTP/1.1\r\n\r\n",
+        "CONNECT example.com:443 HTTP/1.1\r\n\r\n",
+        "OPTIONS * HTTP/1.1\r\n\r\n"
+    };
+
+    for(size_t i = 0; i < sizeof(valid) / sizeof(valid[0]); ++i)
+    {
+        const std::string text = valid[i];
+
+        SmallRequest request;
+        FixedRequestParser parser;
+
+        BOOST_CHECK_EQUAL(parser.parse(request, text.data(), text.data() + text.size()),
+                          FixedRequestParser::ParsingCompleted);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,183 @@
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <httpparser/request.h>
+#include <httpparser/response.h>
+#include <httpparser/httprequestparser.h>
+#include <httpparser/httpresponseparser.h>
+
+BOOST_AUTO_TEST_SUITE(HeadersCompletedTest)
+
+using httpparser::HttpRequestParser;
+using httpparser::HttpResponseParser;
+using httpparser::Request;
+using httpparser::Response;
+
+BOOST_AUTO_TEST_CASE(expect_continue)
+{
+    const std::string head = "POST /upload HTTP/1.1\r\n"
+                             "Content-Length: 11\r\n"
+                             "Expect: 100-continue\r\n"
+                             "\r\n";
+    const std::string text = head + "hello world";
+
+    Request request;
+    HttpRequestParser parser;
+    parser.setStopAfterHeaders(true);
+
+    BOOST_REQUIRE_EQUAL(parser.parse(request, text.data(), text.data() + text.size()),
+                        HttpRequestParser::HeadersCompleted);
+    BOOST_CHECK_EQUAL(parser.consumed(), head.size());
+    BOOST_CHECK_EQUAL(parser.contentLength(), 11);
+    BOOST_CHECK_EQUAL(parser.isChunked(), false);
+    BOOST_CHECK_EQUAL(parser.expectContinue(), true);
+    BOOST_CHECK_EQUAL(request.keepAlive, true);
+    BOOST_CHECK(request.content.empty());
+
+    const char *body = text.data() + parser.consumed();
+
+    BOOST_REQUIRE_EQUAL(parser.parse(request, body, text.data() + text.size()),
+                        HttpRequestParser::ParsingCompleted);
+    BOOST_CHECK_EQUAL(parser.consumed(), 11);
+    BOOST_CHECK_EQUAL(std::string(request.content.begin(), request.content.end()), "hello world");
+}
+
+BOOST_AUTO_TEST_CASE(chunked_request)
+{
+    const std::string text = "PUT /upload HTTP/1.0\r\n"
+                             "Transfer-Encoding: chunked\r\n"
+                             "\r\n"
+                             "5\r\nhello\r\n0\r\n\r\n";
+
+    Request request;
+    HttpRequestParser parser;
+    parser.setStopAfterHeaders(true);
+
+    BOOST_REQUIRE_EQUAL(parser.parse(request, text.data(), text.data() + text.size()),
+                        HttpRequestParser::HeadersCompleted);
+    BOOST_CHECK_EQUAL(parser.isChunked(), true);
+    BOOST_CHECK_EQUAL(parser.expectContinue(), false);
+    BOOST_CHECK_EQUAL(request.keepAlive, false);
+
+    const char *body = text.data() + parser.consumed();
+
+    BOOST_REQUIRE_EQUAL(parser.parse(request, body, text.data() + text.size()),
+                        HttpRequestParser::ParsingCompleted);
+    BOOST_CHECK_EQUAL(std::string(request.content.begin(), request.content.end()), "hello");
+}
+
+BOOST_AUTO_TEST_CASE(request_without_body_completes)
+{
+    const std::string text = "GET / HTTP/1.1\r\n\r\nGET /next HTTP/1.1\r\n\r\n";
+
+    Request request;
+    HttpRequestParser parser;
+    parser.setStopAfterHeaders(true);
+
+    BOOST_CHECK_EQUAL(parser.parse(request, text.data(), text.data() + text.size()),
+                      HttpRequestParser::ParsingCompleted);
+    BOOST_CHECK_EQUAL(parser.consumed(), 18);
+}
+
+BOOST_AUTO_TEST_CASE(response_headers)
+{
+    const std::string text = "HTTP/1.1 200 OK\r\n"
+                             "Content-Length: 8\r\n"
+                             "\r\n"
+                             "<html />";
+
+    Response response;
+    HttpResponseParser parser;
+    parser.setStopAfterHeaders(true);
+
+    BOOST_REQUIRE_EQUAL(parser.parse(response, text.data(), text.data() + text.size()),
+                        HttpResponseParser::HeadersCompleted);
+    BOOST_CHECK_EQUAL(parser.contentLength(), 8);
+    BOOST_CHECK_EQUAL(response.statusCode, 200);
+
+    const char *body = text.data() + parser.consumed();
+
+    BOOST_REQUIRE_EQUAL(parser.parse(response, body, text.data() + text.size()),
+                        HttpResponseParser::ParsingCompleted);
+    BOOST_CHECK_EQUAL(std::string(response.content.begin(), response.content.end()), "<html />");
+}
+
+BOOST_AUTO_TEST_CASE(huge_content_length_can_be_rejected)
+{
+    // Nothing is reserved before the caller sees the length.
+    const std::string text = "POST /upload HTTP/1.1\r\n"
+                             "Content-Length: 3000000000\r\n"
+                             "\r\n";
+
+    Request request;
+    HttpRequestParser parser;
+    parser.setStopAfterHeaders(true);
+
+    BOOST_REQUIRE_EQUAL(parser.parse(request, text.data(), text.data() + text.size()),
+                        HttpRequestParser::HeadersCompleted);
+    BOOST_CHECK_EQUAL(parser.contentLength(), 3000000000u);
+    BOOST_CHECK_EQUAL(request.content.capacity(), 0u);
+
+    Response response;
+    HttpResponseParser responseParser;
+    responseParser.setStopAfterHeaders(true);
+    const std::string responseText = "HTTP/1.1 200 OK\r\nContent-Length: 3000000000\r\n\r\n";
+
+    BOOST_REQUIRE_EQUAL(responseParser.parse(response, responseText.data(), responseText.data() + responseText.size()),
+                        HttpResponseParser::HeadersCompleted);
+    BOOST_CHECK_EQUAL(responseParser.contentLength(), 3000000000u);
+    BOOST_CHECK_EQUAL(response.content.capacity(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(malformed_content_length)
+{
+    const char *values[] = {
+        "-1",
+        "",
+        "12abc",
+        "0x10",
+        "1 2",
+        "99999999999999999999999999"
+    };
+
+    for(size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+    {
+        const std::string text = std::string("POST /upload HTTP/1.1\r\nContent-Length: ") + values[i] + "\r\n\r\n";
+
+        Request request;
+        HttpRequestParser parser;
+        parser.setStopAfterHeaders(true);
+
+        BOOST_CHECK_EQUAL(parser.parse(request, text.data(), text.data() + text.size()),
+                          HttpRequestParser::ParsingError);
+
+        // The same in one pass over a complete head.
+        Request waited;
+        HttpRequestParser waiting;
+        waiting.setWaitForHead(true);
+
+        BOOST_CHECK_EQUAL(waiting.parse(waited, text.data(), text.data() + text.size()),
+                          HttpRequestParser::ParsingError);
+
+        const std::string responseText = std::string("HTTP/1.1 200 OK\r\nContent-Length: ") + values[i] + "\r\n\r\n";
+
+        Response response;
+        HttpResponseParser responseParser;
+
+        BOOST_CHECK_EQUAL(responseParser.parse(response, responseText.data(), responseText.data() + responseText.size()),
+                          HttpResponseParser::ParsingError);
+    }
+
+    // Surrounding whitespace is allowed.
+    const std::string text = "POST /upload HTTP/1.1\r\nContent-Length: 5 \r\n\r\nhello";
+    Request request;
+    HttpRequestParser parser;
+
+    BOOST_CHECK_EQUAL(parser.parse(request, text.data(), text.data() + text.size()),
+                      HttpRequestParser::ParsingCompleted);
+    BOOST_CHECK_EQUAL(request.content.capacity(), 5u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,122 @@
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <string.h>
+
+#include <httpparser/httpstatus.h>
+#include <httpparser/httpserializer.h>
+#include <httpparser/httpresponseparser.h>
+
+#include "common.h"
+
+BOOST_AUTO_TEST_SUITE(Status)
+
+using httpparser::HttpDate;
+using httpparser::HttpResponseParser;
+using httpparser::HttpSerializer;
+using httpparser::HttpStatus;
+using httpparser::Response;
+
+BOOST_AUTO_TEST_CASE(reason_phrase)
+{
+    BOOST_CHECK_EQUAL(HttpStatus::reasonPhrase(200), "OK");
+    BOOST_CHECK_EQUAL(HttpStatus::reasonPhrase(404), "Not Found");
+    BOOST_CHECK(HttpStatus::reasonPhrase(299) == NULL);
+}
+
+BOOST_AUTO_TEST_CASE(status_line)
+{
+    const char *data = NULL;
+    size_t size = 0;
+
+    BOOST_REQUIRE(HttpStatus::statusLine(503, data, size));
+    BOOST_CHECK_EQUAL(std::string(data, size), "HTTP/1.1 503 Service Unavailable\r\n");
+    BOOST_CHECK(!HttpStatus::statusLine(999, data, size));
+}
+
+BOOST_AUTO_TEST_CASE(date_format)
+{
+    char text[HttpDate::size];
+
+    HttpDate::format(784111777, text);
+    BOOST_CHECK_EQUAL(std::string(text, HttpDate::size), "Sun, 06 Nov 1994 08:49:37 GMT");
+
+    HttpDate::format(951782400, text);
+    BOOST_CHECK_EQUAL(std::string(text, HttpDate::size), "Tue, 29 Feb 2000 00:00:00 GMT");
+}
+
+BOOST_AUTO_TEST_CASE(date_now_is_cached)
+{
+    const char *first = HttpDate::now();
+    const char *second = HttpDate::now();
+
+    BOOST_CHECK(first == second);
+    BOOST_CHECK_EQUAL(std::string(first + HttpDate::size - 4, 4), " GMT");
+}
+
+BOOST_AUTO_TEST_CASE(serializer_uses_status_table)
+{
+    Response response = ResponseDsl()
+            .statusCode(200)
+            .status("OK")
+            .version(1, 1)
+            .header("Content-Length", "0");
+
+    HttpSerializer serializer;
+    struct iovec iov[8];
+    size_t count = serializer.gather(response, iov, 8);
+
+    const char *line = NULL;
+    size_t size = 0;
+    HttpStatus::statusLine(200, line, size);
+
+    BOOST_REQUIRE_EQUAL(count, HttpSerializer::iovecCount(response));
+    BOOST_CHECK(iov[0].iov_base == line);
+    BOOST_CHECK_EQUAL(iov[0].iov_len, size);
+}
+
+BOOST_AUTO_TEST_CASE(serializer_keeps_custom_reason)
+{
+    Response response = ResponseDsl()
+            .statusCode(200)
+            .status("Fine")
+            .version(1, 1);
+
+    std::vector<char> buffer;
+    HttpSerializer::serialize(response, buffer);
+
+    BOOST_CHECK_EQUAL(std::string(buffer.begin(), buffer.end()), "HTTP/1.1 200 Fine\r\n\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(serializer_date_header)
+{
+    Response response = ResponseDsl()
+            .statusCode(204)
+            .status("No Content")
+            .version(1, 1);
+
+    std::vector<char> buffer;
+    HttpSerializer::serialize(response, buffer, true);
+    BOOST_CHECK_EQUAL(buffer.size(), HttpSerializer::size(response, true));
+
+    HttpSerializer serializer;
+    std::vector<struct iovec> iov(HttpSerializer::iovecCount(response, true));
+    size_t count = serializer.gather(response, &iov[0], iov.size(), true);
+
+    std::string gathered;
+    for(size_t i = 0; i < count; ++i)
+        gathered.append(static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+
+    Response parsed;
+    HttpResponseParser parser;
+
+    BOOST_REQUIRE_EQUAL(parser.parse(parsed, gathered.data(), gathered.data() + gathered.size()),
+                        HttpResponseParser::ParsingCompleted);
+    BOOST_REQUIRE_EQUAL(parsed.headers.size(), 1);
+    BOOST_CHECK_EQUAL(parsed.headers[0].name, "Date");
+    BOOST_CHECK_EQUAL(parsed.headers[0].value.size(), HttpDate::size);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
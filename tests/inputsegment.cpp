@@ -0,0 +1,248 @@
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <httpparser/request.h>
+#include <httpparser/response.h>
+#include <httpparser/httprequestparser.h>
+#include <httpparser/httpresponseparser.h>
+#include <httpparser/fixedrequestparser.h>
+
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(InputSegmentTest)
+
+using httpparser::FixedRequest;
+using httpparser::FixedRequestParser;
+using httpparser::HttpRequestParser;
+using httpparser::HttpResponseParser;
+using httpparser::InputSegment;
+using httpparser::MessageLayout;
+using httpparser::Request;
+using httpparser::Response;
+
+static const std::string postText =
+        "POST /upload?x=1 HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "Content-Length: 11\r\n"
+        "\r\n"
+        "hello world";
+
+static const std::string getText =
+        "GET /next HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "\r\n";
+
+// The pieces of `text` cut at the given offsets, each in its own buffer
+// so that the segments really are apart.
+struct Pieces
+{
+    Pieces(const std::string &text, const std::vector<size_t> &cuts)
+    {
+        size_t from = 0;
+
+        for(size_t i = 0; i <= cuts.size(); ++i)
+        {
+            size_t to = i < cuts.size() ? cuts[i] : text.size();
+            buffers.push_back(std::vector<char>(text.begin() + from, text.begin() + to));
+            from = to;
+        }
+
+        for(size_t i = 0; i < buffers.size(); ++i)
+        {
+            InputSegment segment = { buffers[i].empty() ? NULL : &buffers[i][0], buffers[i].size() };
+            segments.push_back(segment);
+        }
+    }
+
+    std::vector<std::vector<char> > buffers;
+    std::vector<InputSegment> segments;
+};
+
+BOOST_AUTO_TEST_CASE(request_split_anywhere)
+{
+    // Every pair of cut points, empty pieces included.
+    for(size_t a = 0; a <= postText.size(); ++a)
+    {
+        for(size_t b = a; b <= postText.size(); b += 3)
+        {
+            std::vector<size_t> cuts;
+            cuts.push_back(a);
+            cuts.push_back(b);
+            Pieces pieces(postText, cuts);
+
+            Request req;
+            HttpRequestParser parser;
+            HttpRequestParser::ParseResult res = parser.parse(req, &pieces.segments[0], pieces.segments.size());
+
+            BOOST_REQUIRE_EQUAL(res, HttpRequestParser::ParsingCompleted);
+            BOOST_CHECK_EQUAL(parser.consumed(), postText.size());
+            BOOST_CHECK_EQUAL(req.method, "POST");
+            BOOST_CHECK_EQUAL(req.uri, "/upload?x=1");
+            BOOST_REQUIRE_EQUAL(req.headers.size(), 2u);
+            BOOST_CHECK_EQUAL(req.headers[0].value, "example.com");
+            BOOST_CHECK_EQUAL(req.headers[1].value, "11");
+            BOOST_CHECK_EQUAL(std::string(req.content.begin(), req.content.end()), "hello world");
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(incomplete_request_uses_every_segment)
+{
+    std::vector<size_t> cuts;
+    cuts.push_back(10);
+    cuts.push_back(30);
+    Pieces pieces(postText.substr(0, 50), cuts);
+
+    Request req;
+    HttpRequestParser parser;
+
+    BOOST_CHECK_EQUAL(parser.parse(req, &pieces.segments[0], pieces.segments.size()),
+                      HttpRequestParser::ParsingIncompleted);
+    BOOST_CHECK_EQUAL(parser.consumed(), 50u);
+
+    // The rest arrives contiguous.
+    std::string rest = postText.substr(50);
+    BOOST_CHECK_EQUAL(parser.parse(req, rest.data(), rest.data() + rest.size()),
+                      HttpRequestParser::ParsingCompleted);
+    BOOST_CHECK_EQUAL(std::string(req.content.begin(), req.content.end()), "hello world");
+}
+
+BOOST_AUTO_TEST_CASE(pipelined_requests)
+{
+    // The first request ends inside the second segment.
+    std::string text = postText + getText;
+    std::vector<size_t> cuts;
+    cuts.push_back(20);
+    cuts.push_back(postText.size() + 5);
+    Pieces pieces(text, cuts);
+
+    Request req;
+    HttpRequestParser parser;
+
+    BOOST_CHECK_EQUAL(parser.parse(req, &pieces.segments[0], pieces.segments.size()),
+                      HttpRequestParser::ParsingCompleted);
+    BOOST_CHECK_EQUAL(parser.consumed(), postText.size());
+
+    // Continue with the segments from where the first request stopped.
+    size_t skip = parser.consumed() - pieces.segments[0].size;
+    InputSegment rest[2] = {
+        { pieces.segments[1].data + skip, pieces.segments[1].size - skip },
+        pieces.segments[2]
+    };
+
+    req.clear();
+    parser = HttpRequestParser();
+
+    BOOST_CHECK_EQUAL(parser.parse(req, rest, 2), HttpRequestParser::ParsingCompleted);
+    BOOST_CHECK_EQUAL(parser.consumed(), getText.size());
+    BOOST_CHECK_EQUAL(req.uri, "/next");
+}
+
+BOOST_AUTO_TEST_CASE(layout_matches_contiguous_input)
+{
+    Request expectedReq;
+    MessageLayout expected;
+    HttpRequestParser contiguous;
+    contiguous.setLayout(&expected);
+    contiguous.parse(expectedReq, postText.data(), postText.data() + postText.size());
+
+    std::vector<size_t> cuts;
+    cuts.push_back(7);
+    cuts.push_back(40);
+    cuts.push_back(postText.size() - 4);
+    Pieces pieces(postText, cuts);
+
+    Request req;
+    MessageLayout layout;
+    HttpRequestParser parser;
+    parser.setLayout(&layout);
+    parser.parse(req, &pieces.segments[0], pieces.segments.size());
+
+    BOOST_CHECK_EQUAL(layout.size, expected.size);
+    BOOST_CHECK_EQUAL(layout.headSize, expected.headSize);
+    BOOST_CHECK_EQUAL(layout.startLine.length, expected.startLine.length);
+    BOOST_REQUIRE_EQUAL(layout.headers.size(), expected.headers.size());
+    BOOST_CHECK_EQUAL(layout.headers[1].offset, expected.headers[1].offset);
+    BOOST_REQUIRE_EQUAL(layout.body.size(), 1u);
+    BOOST_CHECK_EQUAL(layout.body[0].offset, expected.body[0].offset);
+    BOOST_CHECK_EQUAL(layout.body[0].length, expected.body[0].length);
+}
+
+BOOST_AUTO_TEST_CASE(chunked_response)
+{
+    const std::string text =
+            "HTTP/1.1 200 OK\r\n"
+            "Transfer-Encoding: chunked\r\n"
+            "\r\n"
+            "5\r\nhello\r\n"
+            "6\r\n world\r\n"
+            "0\r\n\r\n";
+
+    for(size_t a = 1; a < text.size(); ++a)
+    {
+        std::vector<size_t> cuts;
+        cuts.push_back(a);
+        Pieces pieces(text, cuts);
+
+        Response resp;
+        HttpResponseParser parser;
+
+        BOOST_REQUIRE_EQUAL(parser.parse(resp, &pieces.segments[0], pieces.segments.size()),
+                            HttpResponseParser::ParsingCompleted);
+        BOOST_CHECK_EQUAL(parser.consumed(), text.size());
+        BOOST_CHECK_EQUAL(std::string(resp.content.begin(), resp.content.end()), "hello world");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(error_in_a_later_segment)
+{
+    std::vector<size_t> cuts;
+    cuts.push_back(16);
+    Pieces pieces("GET / HTTP/1.1\r\nBad Header\r\n\r\n", cuts);
+
+    Request req;
+    HttpRequestParser parser;
+
+    BOOST_CHECK_EQUAL(parser.parse(req, &pieces.segments[0], pieces.segments.size()),
+                      HttpRequestParser::ParsingError);
+}
+
+BOOST_AUTO_TEST_CASE(wait_for_head_needs_a_contiguous_head)
+{
+    std::vector<size_t> cuts;
+    cuts.push_back(10);
+    Pieces pieces(getText, cuts);
+
+    Request req;
+    HttpRequestParser parser;
+    parser.setWaitForHead(true);
+
+    // Nothing of the first segment is used, so the second is not looked at.
+    BOOST_CHECK_EQUAL(parser.parse(req, &pieces.segments[0], pieces.segments.size()),
+                      HttpRequestParser::ParsingIncompleted);
+    BOOST_CHECK_EQUAL(parser.consumed(), 0u);
+
+    BOOST_CHECK_EQUAL(parser.parse(req, getText.data(), getText.data() + getText.size()),
+                      HttpRequestParser::ParsingCompleted);
+}
+
+BOOST_AUTO_TEST_CASE(fixed_request)
+{
+    std::vector<size_t> cuts;
+    cuts.push_back(3);
+    cuts.push_back(25);
+    Pieces pieces(postText, cuts);
+
+    FixedRequest<8, 256> req;
+    FixedRequestParser parser;
+
+    BOOST_CHECK_EQUAL(parser.parse(req, &pieces.segments[0], pieces.segments.size()),
+                      FixedRequestParser::HeadersCompleted);
+    BOOST_CHECK_EQUAL(parser.consumed(), postText.size() - 11);
+    BOOST_CHECK_EQUAL(parser.contentLength(), 11u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,136 @@
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <httpparser/request.h>
+#include <httpparser/response.h>
+#include <httpparser/httprequestparser.h>
+#include <httpparser/httpresponseparser.h>
+#include <httpparser/messagelayout.h>
+
+BOOST_AUTO_TEST_SUITE(MessageLayoutTest)
+
+using httpparser::HttpRequestParser;
+using httpparser::HttpResponseParser;
+using httpparser::MessageLayout;
+using httpparser::Request;
+using httpparser::Response;
+
+static std::string span(const std::string &text, const MessageLayout::Span &span)
+{
+    return text.substr(span.offset, span.length);
+}
+
+static const std::string chunkedRequest =
+        "POST /upload HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "X-Long: first\r\n"
+        " second\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "5\r\n"
+        "hello\r\n"
+        "6; ext=1\r\n"
+        " world\r\n"
+        "0\r\n"
+        "\r\n";
+
+BOOST_AUTO_TEST_CASE(request_spans)
+{
+    // Feed the request in small pieces to check offsets across calls.
+    for(size_t step = 1; step < 8; ++step)
+    {
+        Request request;
+        MessageLayout layout;
+        HttpRequestParser parser;
+        parser.setLayout(&layout);
+
+        HttpRequestParser::ParseResult result = HttpRequestParser::ParsingIncompleted;
+
+        for(size_t i = 0; i < chunkedRequest.size() && result == HttpRequestParser::ParsingIncompleted; i += step)
+        {
+            const char *begin = chunkedRequest.data() + i;
+            result = parser.parse(request, begin, chunkedRequest.data() + std::min(chunkedRequest.size(), i + step));
+        }
+
+        BOOST_REQUIRE_EQUAL(result, HttpRequestParser::ParsingCompleted);
+        BOOST_CHECK_EQUAL(span(chunkedRequest, layout.startLine), "POST /upload HTTP/1.1\r\n");
+
+        BOOST_REQUIRE_EQUAL(layout.headers.size(), request.headers.size());
+        BOOST_REQUIRE_EQUAL(layout.headers.size(), 3);
+        BOOST_CHECK_EQUAL(span(chunkedRequest, layout.headers[0]), "Host: example.com\r\n");
+        BOOST_CHECK_EQUAL(span(chunkedRequest, layout.headers[1]), "X-Long: first\r\n second\r\n");
+        BOOST_CHECK_EQUAL(span(chunkedRequest, layout.headers[2]), "Transfer-Encoding: chunked\r\n");
+
+        BOOST_CHECK_EQUAL(chunkedRequest.substr(layout.headSize, 3), "5\r\n");
+
+        BOOST_REQUIRE_EQUAL(layout.body.size(), 2);
+        BOOST_CHECK_EQUAL(span(chunkedRequest, layout.body[0]), "hello");
+        BOOST_CHECK_EQUAL(span(chunkedRequest, layout.body[1]), " world");
+
+        BOOST_CHECK_EQUAL(layout.size, chunkedRequest.size());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(rewrite_one_header)
+{
+    const std::string text = "GET /index.html HTTP/1.1\r\n"
+                             "Host: example.com\r\n"
+                             "Proxy-Authorization: secret\r\n"
+                             "Accept: */*\r\n"
+                             "\r\n";
+
+    Request request;
+    MessageLayout layout;
+    HttpRequestParser parser;
+    parser.setLayout(&layout);
+
+    BOOST_REQUIRE_EQUAL(parser.parse(request, text.data(), text.data() + text.size()),
+                        HttpRequestParser::ParsingCompleted);
+
+    std::string forwarded = span(text, layout.startLine);
+
+    for(size_t i = 0; i < request.headers.size(); ++i)
+    {
+        if( request.headers[i].name != "Proxy-Authorization" )
+            forwarded += span(text, layout.headers[i]);
+    }
+
+    forwarded += "Via: 1.1 proxy\r\n";
+    forwarded += text.substr(layout.headSize - 2, 2);
+
+    BOOST_CHECK_EQUAL(forwarded, "GET /index.html HTTP/1.1\r\n"
+                                 "Host: example.com\r\n"
+                                 "Accept: */*\r\n"
+                                 "Via: 1.1 proxy\r\n"
+                                 "\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(response_spans)
+{
+    const std::string text = "HTTP/1.1 200 OK\r\n"
+                             "Content-Length: 8\r\n"
+                             "\r\n"
+                             "<html />";
+
+    Response response;
+    MessageLayout layout;
+    HttpResponseParser parser;
+    parser.setLayout(&layout);
+    parser.setDiscardBody(true);
+
+    const char *middle = text.data() + text.size() - 3;
+
+    BOOST_REQUIRE_EQUAL(parser.parse(response, text.data(), middle), HttpResponseParser::ParsingIncompleted);
+    BOOST_REQUIRE_EQUAL(parser.parse(response, middle, text.data() + text.size()),
+                        HttpResponseParser::ParsingCompleted);
+
+    BOOST_CHECK_EQUAL(span(text, layout.startLine), "HTTP/1.1 200 OK\r\n");
+    BOOST_REQUIRE_EQUAL(layout.headers.size(), 1);
+    BOOST_CHECK_EQUAL(span(text, layout.headers[0]), "Content-Length: 8\r\n");
+    BOOST_REQUIRE_EQUAL(layout.body.size(), 1);
+    BOOST_CHECK_EQUAL(span(text, layout.body[0]), "<html />");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,195 @@
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <httpparser/request.h>
+#include <httpparser/response.h>
+#include <httpparser/httprequestparser.h>
+#include <httpparser/httpresponseparser.h>
+#include <httpparser/parserpool.h>
+
+#include <set>
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE(ParserPoolTest)
+
+using httpparser::HttpRequestParser;
+using httpparser::HttpResponseParser;
+using httpparser::ParserPool;
+using httpparser::Request;
+using httpparser::Response;
+
+typedef ParserPool<HttpRequestParser, Request> RequestPool;
+typedef ParserPool<HttpResponseParser, Response> ResponsePool;
+
+static const std::string requestText =
+        "POST /upload HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "Content-Length: 5\r\n"
+        "\r\n"
+        "hello";
+
+BOOST_AUTO_TEST_CASE(entries_are_reused_with_their_memory)
+{
+    RequestPool pool(1);
+    RequestPool::Entry *entry = pool.acquire();
+
+    BOOST_REQUIRE_EQUAL(entry->parser.parse(entry->message, requestText.data(), requestText.data() + requestText.size()),
+                        HttpRequestParser::ParsingCompleted);
+
+    size_t contentCapacity = entry->message.content.capacity();
+    pool.release(entry);
+
+    RequestPool::Entry *again = pool.acquire();
+
+    BOOST_CHECK(again == entry);
+    BOOST_CHECK(again->message.method.empty());
+    BOOST_CHECK(again->message.headers.empty());
+    BOOST_CHECK(again->message.content.empty());
+    BOOST_CHECK_EQUAL(again->message.content.capacity(), contentCapacity);
+
+    // The parser starts over as well.
+    BOOST_CHECK_EQUAL(again->parser.parse(again->message, requestText.data(), requestText.data() + requestText.size()),
+                      HttpRequestParser::ParsingCompleted);
+    BOOST_CHECK_EQUAL(again->message.uri, "/upload");
+
+    pool.release(again);
+}
+
+BOOST_AUTO_TEST_CASE(large_buffers_are_trimmed)
+{
+    RequestPool::Limits limits;
+    limits.maxContentCapacity = 16;
+
+    RequestPool pool(1, limits);
+    RequestPool::Entry *entry = pool.acquire();
+
+    entry->message.content.resize(1024);
+    entry->message.content.resize(8);
+    pool.release(entry);
+
+    entry = pool.acquire();
+    BOOST_CHECK_EQUAL(entry->message.content.capacity(), 0);
+    pool.release(entry);
+}
+
+BOOST_AUTO_TEST_CASE(header_strings_keep_their_memory)
+{
+    RequestPool::Limits limits;
+    limits.maxStringCapacity = 256;
+
+    const std::string text =
+            "GET / HTTP/1.1\r\n"
+            "X-Short: " + std::string(100, 'a') + "\r\n"
+            "X-Long: " + std::string(1000, 'b') + "\r\n"
+            "\r\n";
+
+    RequestPool pool(1, limits);
+    RequestPool::Entry *entry = pool.acquire();
+
+    BOOST_REQUIRE_EQUAL(entry->parser.parse(entry->message, text.data(), text.data() + text.size()),
+                        HttpRequestParser::ParsingCompleted);
+
+    const char *name = entry->message.headers[0].name.data();
+    const char *value = entry->message.headers[0].value.data();
+    size_t valueCapacity = entry->message.headers[0].value.capacity();
+    pool.release(entry);
+
+    entry = pool.acquire();
+    BOOST_CHECK(entry->message.headers.empty());
+    BOOST_REQUIRE_EQUAL(entry->message.spareHeaders.size(), 2u);
+
+    BOOST_REQUIRE_EQUAL(entry->parser.parse(entry->message, text.data(), text.data() + text.size()),
+                        HttpRequestParser::ParsingCompleted);
+    BOOST_REQUIRE_EQUAL(entry->message.headers.size(), 2u);
+    BOOST_CHECK(entry->message.spareHeaders.empty());
+
+    // The first header gets the very same strings back.
+    BOOST_CHECK(entry->message.headers[0].name.data() == name);
+    BOOST_CHECK(entry->message.headers[0].value.data() == value);
+    BOOST_CHECK_EQUAL(entry->message.headers[0].value.capacity(), valueCapacity);
+    BOOST_CHECK_EQUAL(entry->message.headers[0].value, std::string(100, 'a'));
+    BOOST_CHECK_EQUAL(entry->message.headers[1].value, std::string(1000, 'b'));
+
+    // The second value was over maxStringCapacity and was freed instead.
+    pool.release(entry);
+    entry = pool.acquire();
+    BOOST_CHECK(entry->message.spareHeaders[0].value.capacity() < 256u);
+    pool.release(entry);
+}
+
+BOOST_AUTO_TEST_CASE(exhausted_pool_allocates)
+{
+    ResponsePool pool(1);
+
+    ResponsePool::Entry *first = pool.acquire();
+    ResponsePool::Entry *second = pool.acquire();
+
+    BOOST_REQUIRE(first != NULL);
+    BOOST_REQUIRE(second != NULL);
+    BOOST_CHECK(first != second);
+
+    pool.release(second);
+    pool.release(first);
+
+    BOOST_CHECK(pool.acquire() == first);
+    pool.release(first);
+}
+
+BOOST_AUTO_TEST_CASE(local_cache_returns_entries_to_pool)
+{
+    RequestPool pool(4);
+    std::set<RequestPool::Entry *> seen;
+
+    {
+        RequestPool::LocalCache cache(pool);
+
+        for(size_t i = 0; i < 4; ++i)
+            seen.insert(cache.acquire());
+
+        for(std::set<RequestPool::Entry *>::iterator it = seen.begin(); it != seen.end(); ++it)
+            cache.release(*it);
+    }
+
+    for(size_t i = 0; i < 4; ++i)
+        BOOST_CHECK(seen.count(pool.acquire()) == 1);
+}
+
+BOOST_AUTO_TEST_CASE(threads_share_the_pool)
+{
+    RequestPool pool(8);
+    std::vector<std::thread> threads;
+    std::vector<size_t> failures(4, 0);
+
+    for(size_t t = 0; t < failures.size(); ++t)
+    {
+        threads.push_back(std::thread([&pool, &failures, t]() {
+            RequestPool::LocalCache cache(pool);
+
+            for(size_t i = 0; i < 20000; ++i)
+            {
+                RequestPool::Entry *a = cache.acquire();
+                RequestPool::Entry *b = pool.acquire();
+
+                if( a->parser.parse(a->message, requestText.data(), requestText.data() + requestText.size())
+                        != HttpRequestParser::ParsingCompleted || !b->message.uri.empty() )
+                {
+                    ++failures[t];
+                }
+
+                b->message.uri = "taken";
+                pool.release(b);
+                cache.release(a);
+            }
+        }));
+    }
+
+    for(size_t t = 0; t < threads.size(); ++t)
+        threads[t].join();
+
+    for(size_t t = 0; t < failures.size(); ++t)
+        BOOST_CHECK_EQUAL(failures[t], 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
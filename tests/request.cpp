@@ -108,4 +108,145 @@ BOOST_FIXTURE_TEST_CASE(post_http_11_with_header_field, RequestFixture)
     BOOST_CHECK_EQUAL(result.inspect(), should.inspect());
 }
 
+BOOST_FIXTURE_TEST_CASE(origin_form_target, RequestFixture)
+{
+    Request result = parse("GET /dir/file?a=1&b=2#top HTTP/1.1\r\n\r\n");
+
+    BOOST_CHECK_EQUAL(result.uriForm, Request::OriginForm);
+    BOOST_CHECK_EQUAL(result.authority(), "");
+    BOOST_CHECK_EQUAL(result.path(), "/dir/file");
+    BOOST_CHECK_EQUAL(result.query(), "a=1&b=2");
+    BOOST_CHECK_EQUAL(result.fragment(), "top");
+}
+
+BOOST_FIXTURE_TEST_CASE(origin_form_target_without_query, RequestFixture)
+{
+    Request result = parse("GET /a HTTP/1.1\r\n\r\n");
+
+    BOOST_CHECK_EQUAL(result.uriForm, Request::OriginForm);
+    BOOST_CHECK_EQUAL(result.path(), "/a");
+    BOOST_CHECK_EQUAL(result.query(), "");
+}
+
+BOOST_FIXTURE_TEST_CASE(absolute_form_target, RequestFixture)
+{
+    Request result = parse("GET http://example.com:8080/a/b?q=1 HTTP/1.1\r\n\r\n");
+
+    BOOST_CHECK_EQUAL(result.uri, "http://example.com:8080/a/b?q=1");
+    BOOST_CHECK_EQUAL(result.uriForm, Request::AbsoluteForm);
+    BOOST_CHECK_EQUAL(result.authority(), "example.com:8080");
+    BOOST_CHECK_EQUAL(result.path(), "/a/b");
+    BOOST_CHECK_EQUAL(result.query(), "q=1");
+}
+
+BOOST_FIXTURE_TEST_CASE(absolute_form_target_without_path, RequestFixture)
+{
+    Request result = parse("GET http://example.com?q HTTP/1.1\r\n\r\n");
+
+    BOOST_CHECK_EQUAL(result.uriForm, Request::AbsoluteForm);
+    BOOST_CHECK_EQUAL(result.authority(), "example.com");
+    BOOST_CHECK_EQUAL(result.path(), "/");
+    BOOST_CHECK_EQUAL(result.query(), "q");
+}
+
+BOOST_FIXTURE_TEST_CASE(authority_form_target, RequestFixture)
+{
+    Request result = parse("CONNECT example.com:443 HTTP/1.1\r\n\r\n");
+
+    BOOST_CHECK_EQUAL(result.method, "CONNECT");
+    BOOST_CHECK_EQUAL(result.uriForm, Request::AuthorityForm);
+    BOOST_CHECK_EQUAL(result.authority(), "example.com:443");
+    BOOST_CHECK_EQUAL(result.path(), "");
+}
+
+BOOST_FIXTURE_TEST_CASE(asterisk_form_target, RequestFixture)
+{
+    Request result = parse("OPTIONS * HTTP/1.1\r\n\r\n");
+
+    BOOST_CHECK_EQUAL(result.method, "OPTIONS");
+    BOOST_CHECK_EQUAL(result.uriForm, Request::AsteriskForm);
+    BOOST_CHECK_EQUAL(result.uri, "*");
+}
+
+BOOST_AUTO_TEST_CASE(target_without_scheme_is_rejected)
+{
+    // Not absolute-form without "scheme:", nor any of the other forms.
+    const char *targets[] = { "foo/x", "example.com", "1http://example.com/", "ht@tp://example.com/" };
+
+    for(size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); ++i)
+    {
+        std::string text = std::string("GET ") + targets[i] + " HTTP/1.1\r\n\r\n";
+
+        Request request;
+        HttpRequestParser parser;
+        BOOST_CHECK_EQUAL(parser.parse(request, text.data(), text.data() + text.size()), HttpRequestParser::ParsingError);
+
+        // The head-at-once path agrees.
+        Request head;
+        HttpRequestParser headParser;
+        headParser.setWaitForHead(true);
+        BOOST_CHECK_EQUAL(headParser.parse(head, text.data(), text.data() + text.size()), HttpRequestParser::ParsingError);
+    }
+
+    const char text[] = "GET foo/x\r\n";
+    Request request;
+    HttpRequestParser parser;
+    BOOST_CHECK_EQUAL(parser.parse(request, text, text + sizeof(text) - 1), HttpRequestParser::ParsingError);
+}
+
+BOOST_FIXTURE_TEST_CASE(absolute_form_scheme_characters, RequestFixture)
+{
+    Request result = parse("GET coap+tcp.v-2://example.com/a HTTP/1.1\r\n\r\n");
+
+    BOOST_CHECK_EQUAL(result.uriForm, Request::AbsoluteForm);
+    BOOST_CHECK_EQUAL(result.authority(), "example.com");
+    BOOST_CHECK_EQUAL(result.path(), "/a");
+}
+
+BOOST_AUTO_TEST_CASE(asterisk_form_target_with_garbage)
+{
+    const char text[] = "OPTIONS *x HTTP/1.1\r\n\r\n";
+    Request request;
+    HttpRequestParser parser;
+
+    BOOST_CHECK_EQUAL(parser.parse(request, text, text + sizeof(text) - 1), HttpRequestParser::ParsingError);
+}
+
+BOOST_AUTO_TEST_CASE(common_prefixes_split_anywhere)
+{
+    const char *texts[] = {
+        "GET /a HTTP/1.1\r\n\r\n",
+        "POST /b HTTP/1.0\r\nContent-Length: 1\r\n\r\nx",
+        "PUT /c HTTP/1.1\r\n\r\n",
+        "GETS /d HTTP/1.2\r\n\r\n"
+    };
+
+    for(size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); ++i)
+    {
+        const std::string text = texts[i];
+
+        Request whole;
+        HttpRequestParser wholeParser;
+
+        BOOST_REQUIRE_EQUAL(wholeParser.parse(whole, text.data(), text.data() + text.size()),
+                            HttpRequestParser::ParsingCompleted);
+
+        Request split;
+        HttpRequestParser splitParser;
+        HttpRequestParser::ParseResult res = HttpRequestParser::ParsingIncompleted;
+
+        for(size_t pos = 0; pos < text.size(); ++pos)
+            res = splitParser.parse(split, text.data() + pos, text.data() + pos + 1);
+
+        BOOST_CHECK_EQUAL(res, HttpRequestParser::ParsingCompleted);
+        BOOST_CHECK_EQUAL(split.inspect(), whole.inspect());
+    }
+
+    const char bad[] = "GET / HTTP/1.1\n\r\n";
+    Request request;
+    HttpRequestParser parser;
+
+    BOOST_CHECK_EQUAL(parser.parse(request, bad, bad + sizeof(bad) - 1), HttpRequestParser::ParsingError);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -126,4 +126,34 @@ BOOST_FIXTURE_TEST_CASE(chunk_extension, ResponseFixture)
     BOOST_CHECK_EQUAL(result.inspect(), should.inspect());
 }
 
+BOOST_AUTO_TEST_CASE(common_prefixes_split_anywhere)
+{
+    const char *texts[] = {
+        "HTTP/1.1 204 No Content\r\n\r\n",
+        "HTTP/1.0 200 OK\r\nContent-Length: 1\r\n\r\nx",
+        "HTTP/2.0 204 No Content\r\n\r\n"
+    };
+
+    for(size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); ++i)
+    {
+        const std::string text = texts[i];
+
+        Response whole;
+        HttpResponseParser wholeParser;
+
+        BOOST_REQUIRE_EQUAL(wholeParser.parse(whole, text.data(), text.data() + text.size()),
+                            HttpResponseParser::ParsingCompleted);
+
+        Response split;
+        HttpResponseParser splitParser;
+        HttpResponseParser::ParseResult res = HttpResponseParser::ParsingIncompleted;
+
+        for(size_t pos = 0; pos < text.size(); ++pos)
+            res = splitParser.parse(split, text.data() + pos, text.data() + pos + 1);
+
+        BOOST_CHECK_EQUAL(res, HttpResponseParser::ParsingCompleted);
+        BOOST_CHECK_EQUAL(split.inspect(), whole.inspect());
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
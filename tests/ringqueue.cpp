@@ -0,0 +1,156 @@
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "../benchmarks/ringqueue.h"
+
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(RingQueueTest)
+
+template<typename Queue>
+static void checkFifoAndBounds()
+{
+    Queue queue(5);
+    BOOST_REQUIRE_EQUAL(queue.capacity(), 8u);
+
+    for(size_t i = 0; i < 8; ++i)
+        BOOST_CHECK(queue.push(i));
+
+    BOOST_CHECK(!queue.push(8));
+
+    size_t out[16];
+    BOOST_REQUIRE_EQUAL(queue.popBatch(out, 3), 3u);
+    BOOST_CHECK_EQUAL(out[0], 0u);
+    BOOST_CHECK_EQUAL(out[2], 2u);
+
+    // Wrap around the end of the ring.
+    BOOST_CHECK(queue.push(8));
+    BOOST_CHECK(queue.push(9));
+
+    BOOST_REQUIRE_EQUAL(queue.popBatch(out, 16), 7u);
+
+    for(size_t i = 0; i < 7; ++i)
+        BOOST_CHECK_EQUAL(out[i], i + 3);
+
+    size_t item;
+    BOOST_CHECK(!queue.pop(item));
+    BOOST_CHECK_EQUAL(queue.popBatch(out, 16), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(spsc_fifo_and_bounds)
+{
+    checkFifoAndBounds< SpscQueue<size_t> >();
+}
+
+BOOST_AUTO_TEST_CASE(mpmc_fifo_and_bounds)
+{
+    checkFifoAndBounds< MpmcQueue<size_t> >();
+}
+
+static const size_t itemCount = 200000;
+
+BOOST_AUTO_TEST_CASE(spsc_keeps_order_across_threads)
+{
+    SpscQueue<size_t> queue(64);
+
+    std::thread producer([&queue]() {
+        for(size_t i = 0; i < itemCount; ++i)
+        {
+            while( !queue.push(i) )
+                std::this_thread::yield();
+        }
+    });
+
+    size_t expected = 0;
+    bool ordered = true;
+    size_t out[32];
+
+    while( expected < itemCount )
+    {
+        size_t count = queue.popBatch(out, 32);
+
+        if( count == 0 )
+            std::this_thread::yield();
+
+        for(size_t i = 0; i < count; ++i)
+            ordered = ordered && out[i] == expected++;
+    }
+
+    producer.join();
+    BOOST_CHECK(ordered);
+    BOOST_CHECK(queue.empty());
+}
+
+BOOST_AUTO_TEST_CASE(mpmc_delivers_every_item_once)
+{
+    enum { producers = 3, consumers = 3 };
+
+    MpmcQueue<size_t> queue(128);
+    std::vector<std::vector<size_t> > received(consumers);
+    std::atomic<size_t> remaining(itemCount * producers);
+    std::vector<std::thread> threads;
+
+    for(size_t p = 0; p < producers; ++p)
+    {
+        threads.push_back(std::thread([&queue, p]() {
+            for(size_t i = 0; i < itemCount; ++i)
+            {
+                while( !queue.push(p * itemCount + i) )
+                    std::this_thread::yield();
+            }
+        }));
+    }
+
+    for(size_t c = 0; c < consumers; ++c)
+    {
+        threads.push_back(std::thread([&queue, &remaining, &received, c]() {
+            size_t out[16];
+
+            while( remaining.load() > 0 )
+            {
+                size_t count = queue.popBatch(out, 16);
+
+                if( count == 0 )
+                    std::this_thread::yield();
+
+                received[c].insert(received[c].end(), out, out + count);
+                remaining -= count;
+            }
+        }));
+    }
+
+    for(size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+
+    std::vector<size_t> seen(itemCount * producers, 0);
+    bool ordered = true;
+
+    for(size_t c = 0; c < consumers; ++c)
+    {
+        std::vector<size_t> last(producers, 0);
+
+        for(size_t i = 0; i < received[c].size(); ++i)
+        {
+            size_t item = received[c][i];
+            ++seen[item];
+
+            // Items of one producer reach a consumer in the order pushed.
+            size_t p = item / itemCount;
+            ordered = ordered && (last[p] == 0 || item > last[p]);
+            last[p] = item;
+        }
+    }
+
+    bool once = true;
+
+    for(size_t i = 0; i < seen.size(); ++i)
+        once = once && seen[i] == 1;
+
+    BOOST_CHECK(once);
+    BOOST_CHECK(ordered);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,154 @@
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <httpparser/request.h>
+#include <httpparser/response.h>
+#include <httpparser/httprequestparser.h>
+#include <httpparser/httpresponseparser.h>
+#include <httpparser/httpserializer.h>
+
+#include "common.h"
+
+BOOST_AUTO_TEST_SUITE(Serializer)
+
+using httpparser::HttpRequestParser;
+using httpparser::HttpResponseParser;
+using httpparser::HttpSerializer;
+using httpparser::Request;
+using httpparser::Response;
+
+static std::string join(const struct iovec *iov, size_t count)
+{
+    std::string result;
+
+    for(size_t i = 0; i < count; ++i)
+        result.append(static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+
+    return result;
+}
+
+static std::string serialize(const Request &req)
+{
+    std::vector<char> buffer;
+    HttpSerializer::serialize(req, buffer);
+    return std::string(buffer.begin(), buffer.end());
+}
+
+static std::string serialize(const Response &resp)
+{
+    std::vector<char> buffer;
+    HttpSerializer::serialize(resp, buffer);
+    return std::string(buffer.begin(), buffer.end());
+}
+
+BOOST_AUTO_TEST_CASE(request_round_trip)
+{
+    const std::string text = "POST /uri.cgi HTTP/1.1\r\n"
+                             "Host: 127.0.0.1\r\n"
+                             "Content-Length: 9\r\n"
+                             "\r\n"
+                             "arg1=test";
+
+    Request request;
+    HttpRequestParser parser;
+
+    BOOST_REQUIRE_EQUAL(parser.parse(request, text.data(), text.data() + text.size()),
+                        HttpRequestParser::ParsingCompleted);
+
+    BOOST_CHECK_EQUAL(serialize(request), text);
+    BOOST_CHECK_EQUAL(HttpSerializer::size(request), text.size());
+
+    HttpSerializer serializer;
+    std::vector<struct iovec> iov(HttpSerializer::iovecCount(request));
+
+    size_t count = serializer.gather(request, &iov[0], iov.size());
+
+    BOOST_CHECK_EQUAL(count, iov.size());
+    BOOST_CHECK_EQUAL(join(&iov[0], count), text);
+}
+
+BOOST_AUTO_TEST_CASE(request_http_09)
+{
+    Request request = RequestDsl()
+            .method("GET")
+            .uri("/uri")
+            .version(0, 9);
+
+    BOOST_CHECK_EQUAL(serialize(request), "GET /uri\r\n");
+
+    HttpSerializer serializer;
+    struct iovec iov[4];
+
+    size_t count = serializer.gather(request, iov, 4);
+    BOOST_CHECK_EQUAL(join(iov, count), "GET /uri\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(response_round_trip)
+{
+    const std::string text = "HTTP/1.1 200 OK\r\n"
+                             "Server: nginx/1.2.1\r\n"
+                             "Content-Length: 8\r\n"
+                             "\r\n"
+                             "<html />";
+
+    Response response;
+    HttpResponseParser parser;
+
+    BOOST_REQUIRE_EQUAL(parser.parse(response, text.data(), text.data() + text.size()),
+                        HttpResponseParser::ParsingCompleted);
+
+    BOOST_CHECK_EQUAL(serialize(response), text);
+    BOOST_CHECK_EQUAL(HttpSerializer::size(response), text.size());
+
+    HttpSerializer serializer;
+    std::vector<struct iovec> iov(HttpSerializer::iovecCount(response));
+
+    size_t count = serializer.gather(response, &iov[0], iov.size());
+
+    BOOST_CHECK_EQUAL(count, iov.size());
+    BOOST_CHECK_EQUAL(join(&iov[0], count), text);
+}
+
+BOOST_AUTO_TEST_CASE(response_without_headers_and_content)
+{
+    Response response = ResponseDsl()
+            .statusCode(204)
+            .status("No Content")
+            .version(1, 0);
+
+    BOOST_CHECK_EQUAL(serialize(response), "HTTP/1.0 204 No Content\r\n\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(serialize_appends_to_buffer)
+{
+    Response response = ResponseDsl()
+            .statusCode(404)
+            .status("Not Found")
+            .version(1, 1)
+            .header("Content-Length", "0");
+
+    std::vector<char> buffer;
+    HttpSerializer::serialize(response, buffer);
+    HttpSerializer::serialize(response, buffer);
+
+    const std::string single = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+    BOOST_CHECK_EQUAL(std::string(buffer.begin(), buffer.end()), single + single);
+}
+
+BOOST_AUTO_TEST_CASE(gather_needs_enough_entries)
+{
+    Response response = ResponseDsl()
+            .statusCode(200)
+            .status("OK")
+            .version(1, 1)
+            .header("Content-Length", "0");
+
+    HttpSerializer serializer;
+    struct iovec iov[4];
+
+    BOOST_CHECK_EQUAL(serializer.gather(response, iov, 4), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -132,4 +132,130 @@ BOOST_AUTO_TEST_CASE(svn_over_ssh)
     BOOST_CHECK_EQUAL(parser.path(), "/path/to/file");
 }
 
+BOOST_AUTO_TEST_CASE(http_hostname_and_port_without_path)
+{
+    const char *text = "http://www.example.com:8080";
+    UrlParser parser(text);
+
+    BOOST_CHECK_EQUAL(parser.isValid(), true);
+    BOOST_CHECK_EQUAL(parser.hostname(), "www.example.com");
+    BOOST_CHECK_EQUAL(parser.port(), "8080");
+    BOOST_CHECK_EQUAL(parser.path(), "/");
+    BOOST_CHECK_EQUAL(parser.httpPort(), 8080);
+}
+
+BOOST_AUTO_TEST_CASE(https_default_port)
+{
+    UrlParser parser("https://www.example.com/");
+
+    BOOST_CHECK_EQUAL(parser.isValid(), true);
+    BOOST_CHECK_EQUAL(parser.httpPort(), 443);
+}
+
+BOOST_AUTO_TEST_CASE(invalid_url)
+{
+    UrlParser parser;
+
+    BOOST_CHECK_EQUAL(parser.parse("http://www.exa mple.com/"), false);
+    BOOST_CHECK_EQUAL(parser.isValid(), false);
+}
+
+BOOST_AUTO_TEST_CASE(ipv4_hostname)
+{
+    UrlParser parser("http://192.168.0.1:8080/path");
+    const uint8_t address[] = { 192, 168, 0, 1 };
+
+    BOOST_CHECK_EQUAL(parser.isValid(), true);
+    BOOST_CHECK_EQUAL(parser.hostname(), "192.168.0.1");
+    BOOST_CHECK_EQUAL(parser.hostType(), UrlParser::HostIPv4);
+    BOOST_CHECK_EQUAL_COLLECTIONS(parser.address().bytes, parser.address().bytes + 4,
+                                  address, address + 4);
+    BOOST_CHECK_EQUAL(parser.httpPort(), 8080);
+}
+
+BOOST_AUTO_TEST_CASE(ipv4_like_hostnames)
+{
+    const char *urls[] = {
+        "http://192.168.0.256/",
+        "http://192.168.0/",
+        "http://192.168.0.1.2/",
+        "http://192.168.00.1/",
+        "http://1.2.3.example.com/"
+    };
+
+    for(size_t i = 0; i < sizeof(urls) / sizeof(urls[0]); ++i)
+    {
+        UrlParser parser(urls[i]);
+
+        BOOST_CHECK_EQUAL(parser.isValid(), true);
+        BOOST_CHECK_EQUAL(parser.hostType(), UrlParser::HostName);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ipv6_loopback)
+{
+    UrlParser parser("http://[::1]/");
+    uint8_t address[16] = { 0 };
+    address[15] = 1;
+
+    BOOST_CHECK_EQUAL(parser.isValid(), true);
+    BOOST_CHECK_EQUAL(parser.hostname(), "::1");
+    BOOST_CHECK_EQUAL(parser.hostType(), UrlParser::HostIPv6);
+    BOOST_CHECK_EQUAL_COLLECTIONS(parser.address().bytes, parser.address().bytes + 16,
+                                  address, address + 16);
+    BOOST_CHECK_EQUAL(parser.path(), "/");
+    BOOST_CHECK_EQUAL(parser.httpPort(), 80);
+}
+
+BOOST_AUTO_TEST_CASE(ipv6_with_port_and_username)
+{
+    UrlParser parser("http://user:passwd@[2001:db8::8:800:200c:417a]:8080/path?query");
+    const uint8_t address[] = { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
+                                0, 0x08, 0x08, 0x00, 0x20, 0x0c, 0x41, 0x7a };
+
+    BOOST_CHECK_EQUAL(parser.isValid(), true);
+    BOOST_CHECK_EQUAL(parser.username(), "user");
+    BOOST_CHECK_EQUAL(parser.password(), "passwd");
+    BOOST_CHECK_EQUAL(parser.hostname(), "2001:db8::8:800:200c:417a");
+    BOOST_CHECK_EQUAL_COLLECTIONS(parser.address().bytes, parser.address().bytes + 16,
+                                  address, address + 16);
+    BOOST_CHECK_EQUAL(parser.httpPort(), 8080);
+    BOOST_CHECK_EQUAL(parser.path(), "/path");
+    BOOST_CHECK_EQUAL(parser.query(), "query");
+}
+
+BOOST_AUTO_TEST_CASE(ipv6_with_embedded_ipv4_and_zone)
+{
+    UrlParser parser("http://[::ffff:10.0.0.1%25eth0]:80");
+    const uint8_t address[] = { 0, 0, 0, 0, 0, 0, 0, 0,
+                                0, 0, 0xff, 0xff, 10, 0, 0, 1 };
+
+    BOOST_CHECK_EQUAL(parser.isValid(), true);
+    BOOST_CHECK_EQUAL(parser.hostname(), "::ffff:10.0.0.1");
+    BOOST_CHECK_EQUAL(parser.zone(), "eth0");
+    BOOST_CHECK_EQUAL_COLLECTIONS(parser.address().bytes, parser.address().bytes + 16,
+                                  address, address + 16);
+}
+
+BOOST_AUTO_TEST_CASE(invalid_ipv6)
+{
+    const char *urls[] = {
+        "http://[::1/",
+        "http://[1:2:3:4:5:6:7:8:9]/",
+        "http://[1::2::3]/",
+        "http://[12345::]/",
+        "http://[:1]/",
+        "http://[1:]/",
+        "http://[fe80::1%25]/",
+        "http://[::1]x/",
+        "http://[1:2:3:4:5:6:7:1.2.3.4]/"
+    };
+
+    for(size_t i = 0; i < sizeof(urls) / sizeof(urls[0]); ++i)
+    {
+        UrlParser parser;
+        BOOST_CHECK_MESSAGE(!parser.parse(urls[i]), urls[i]);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
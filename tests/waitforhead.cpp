@@ -0,0 +1,223 @@
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <httpparser/request.h>
+#include <httpparser/response.h>
+#include <httpparser/httprequestparser.h>
+#include <httpparser/httpresponseparser.h>
+#include <httpparser/messagelayout.h>
+
+BOOST_AUTO_TEST_SUITE(WaitForHead)
+
+using httpparser::HttpRequestParser;
+using httpparser::HttpResponseParser;
+using httpparser::MessageLayout;
+using httpparser::Request;
+using httpparser::Response;
+
+static const std::string requestText =
+        "POST /upload?id=7#top HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "Expect: 100-continue\r\n"
+        "Content-Length: 5\r\n"
+        "\r\n"
+        "hello";
+
+static const std::string responseText =
+        "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "Connection: close\r\n"
+        "\r\n"
+        "5\r\nhello\r\n0\r\n\r\n";
+
+// Feed `text` `step` bytes at a time, passing unconsumed bytes again.
+template<typename Parser, typename Message>
+typename Parser::ParseResult feed(Parser &parser, Message &msg, const std::string &text, size_t step)
+{
+    std::string pending;
+    typename Parser::ParseResult result = Parser::ParsingIncompleted;
+
+    for(size_t pos = 0; pos < text.size() && result == Parser::ParsingIncompleted; pos += step)
+    {
+        pending += text.substr(pos, step);
+        result = parser.parse(msg, pending.data(), pending.data() + pending.size());
+        pending.erase(0, parser.consumed());
+    }
+
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE(request_matches_state_machine)
+{
+    for(size_t step = 1; step <= requestText.size(); ++step)
+    {
+        Request expected, request;
+        HttpRequestParser reference, parser;
+        MessageLayout expectedLayout, layout;
+
+        reference.setLayout(&expectedLayout);
+        parser.setLayout(&layout);
+        parser.setWaitForHead(true);
+
+        BOOST_REQUIRE_EQUAL(feed(reference, expected, requestText, step), HttpRequestParser::ParsingCompleted);
+        BOOST_REQUIRE_EQUAL(feed(parser, request, requestText, step), HttpRequestParser::ParsingCompleted);
+
+        BOOST_CHECK_EQUAL(request.inspect(), expected.inspect());
+        BOOST_CHECK_EQUAL(request.path(), "/upload");
+        BOOST_CHECK_EQUAL(request.query(), "id=7");
+        BOOST_CHECK_EQUAL(request.fragment(), "top");
+        BOOST_CHECK(parser.expectContinue());
+        BOOST_CHECK_EQUAL(parser.contentLength(), 5);
+        BOOST_CHECK_EQUAL(layout.startLine.length, expectedLayout.startLine.length);
+        BOOST_REQUIRE_EQUAL(layout.headers.size(), 3);
+        BOOST_CHECK_EQUAL(layout.headers[2].offset, expectedLayout.headers[2].offset);
+        BOOST_CHECK_EQUAL(layout.headers[2].length, expectedLayout.headers[2].length);
+        BOOST_CHECK_EQUAL(layout.headSize, expectedLayout.headSize);
+        BOOST_REQUIRE_EQUAL(layout.body.size(), 1);
+        BOOST_CHECK_EQUAL(layout.body[0].offset, requestText.size() - 5);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(nothing_consumed_before_head_ends)
+{
+    const std::string text = "GET / HTTP/1.1\r\nHost: a\r\n\r";
+
+    Request request;
+    HttpRequestParser parser;
+    parser.setWaitForHead(true);
+
+    BOOST_CHECK_EQUAL(parser.parse(request, text.data(), text.data() + text.size()),
+                      HttpRequestParser::ParsingIncompleted);
+    BOOST_CHECK_EQUAL(parser.consumed(), 0);
+    BOOST_CHECK(request.method.empty());
+
+    const std::string full = text + "\nGET /next HTTP/1.1\r\n\r\n";
+
+    BOOST_CHECK_EQUAL(parser.parse(request, full.data(), full.data() + full.size()),
+                      HttpRequestParser::ParsingCompleted);
+    BOOST_CHECK_EQUAL(full.substr(parser.consumed()), "GET /next HTTP/1.1\r\n\r\n");
+    BOOST_CHECK_EQUAL(request.headers.size(), 1);
+    BOOST_CHECK(request.keepAlive);
+}
+
+BOOST_AUTO_TEST_CASE(request_fallbacks)
+{
+    const std::string folded = "GET / HTTP/1.1\r\n"
+                               "X-Long: first\r\n"
+                               " second\r\n"
+                               "\r\n";
+
+    Request expected, request;
+    HttpRequestParser reference, parser;
+    parser.setWaitForHead(true);
+
+    BOOST_CHECK_EQUAL(reference.parse(expected, folded.data(), folded.data() + folded.size()),
+                      HttpRequestParser::ParsingCompleted);
+    BOOST_CHECK_EQUAL(parser.parse(request, folded.data(), folded.data() + folded.size()),
+                      HttpRequestParser::ParsingCompleted);
+    BOOST_CHECK_EQUAL(request.headers.size(), 1);
+    BOOST_CHECK_EQUAL(request.inspect(), expected.inspect());
+
+    const std::string simple = "GET /index.html\r\n";
+
+    Request simpleRequest;
+    HttpRequestParser simpleParser;
+    simpleParser.setWaitForHead(true);
+
+    BOOST_CHECK_EQUAL(simpleParser.parse(simpleRequest, simple.data(), simple.data() + simple.size()),
+                      HttpRequestParser::ParsingCompleted);
+    BOOST_CHECK_EQUAL(simpleRequest.uri, "/index.html");
+    BOOST_CHECK_EQUAL(simpleRequest.versionMinor, 9);
+}
+
+BOOST_AUTO_TEST_CASE(request_errors)
+{
+    const char *invalid[] = {
+        "G(T / HTTP/1.1\r\n\r\n",
+        "GET / HTTX/1.1\r\n\r\n",
+        "GET / HTTP/1.x\r\n\r\n",
+        "GET / \r\n\r\n",
+        "GET / HTTP/1.1\r\nHost:a\r\n\r\n",
+        "GET / HTTP/1.1\r\nHo st: a\r\n\r\n",
+        "GET / HTTP/1.1\r\n: a\r\n\r\n",
+        "GET / HTTP/1.1\r\nHost: a\x01\r\n\r\n",
+        "GET ** HTTP/1.1\r\n\r\n"
+    };
+
+    for(size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i)
+    {
+        const std::string text = invalid[i];
+
+        Request expected, request;
+        HttpRequestParser reference, parser;
+        parser.setWaitForHead(true);
+
+        BOOST_CHECK_EQUAL(reference.parse(expected, text.data(), text.data() + text.size()),
+                          HttpRequestParser::ParsingError);
+        BOOST_CHECK_EQUAL(parser.parse(request, text.data(), text.data() + text.size()),
+                          HttpRequestParser::ParsingError);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(response_matches_state_machine)
+{
+    for(size_t step = 1; step <= responseText.size(); ++step)
+    {
+        Response expected, response;
+        HttpResponseParser reference, parser;
+        parser.setWaitForHead(true);
+
+        BOOST_REQUIRE_EQUAL(feed(reference, expected, responseText, step), HttpResponseParser::ParsingCompleted);
+        BOOST_REQUIRE_EQUAL(feed(parser, response, responseText, step), HttpResponseParser::ParsingCompleted);
+
+        BOOST_CHECK_EQUAL(response.inspect(), expected.inspect());
+        BOOST_CHECK(parser.isChunked());
+        BOOST_CHECK(!response.keepAlive);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(response_stop_after_headers)
+{
+    Response response;
+    HttpResponseParser parser;
+    parser.setWaitForHead(true);
+    parser.setStopAfterHeaders(true);
+
+    const char *begin = responseText.data();
+    const char *end = begin + responseText.size();
+
+    BOOST_REQUIRE_EQUAL(parser.parse(response, begin, end), HttpResponseParser::HeadersCompleted);
+    BOOST_CHECK_EQUAL(response.status, "OK");
+    BOOST_CHECK_EQUAL(response.statusCode, 200);
+
+    begin += parser.consumed();
+
+    BOOST_CHECK_EQUAL(parser.parse(response, begin, end), HttpResponseParser::ParsingCompleted);
+    BOOST_CHECK_EQUAL(std::string(response.content.begin(), response.content.end()), "hello");
+}
+
+BOOST_AUTO_TEST_CASE(response_errors)
+{
+    const char *invalid[] = {
+        "HTTP/1.1 99 Low\r\n\r\n",
+        "HTTP/1.1 200\r\n\r\n",
+        "HTTP/1.1 200 OK\r\nServer:x\r\n\r\n",
+        "HTTQ/1.1 200 OK\r\n\r\n"
+    };
+
+    for(size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i)
+    {
+        const std::string text = invalid[i];
+
+        Response response;
+        HttpResponseParser parser;
+        parser.setWaitForHead(true);
+
+        BOOST_CHECK_EQUAL(parser.parse(response, text.data(), text.data() + text.size()),
+                          HttpResponseParser::ParsingError);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()